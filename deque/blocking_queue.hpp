@@ -0,0 +1,406 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "deque.hpp"
+
+// Bounded multi-producer multi-consumer FIFO queue with separate head and
+// tail locks, so a producer and a consumer never contend with each other.
+// Elements live in a singly linked chain of buckets sized like Deque's:
+// producers append at the tail bucket and consumers drain the head bucket.
+// Deque itself is not used because growing or recentering its bucket map
+// touches both ends at once. The two sides share only the atomic element
+// count and a one-bucket spare slot that recycles drained buckets through
+// atomic exchanges. Each batch operation takes its lock once.
+template <typename T, size_t BucketSize = DequeBucketSize<T>()>
+class BlockingQueue {
+ public:
+  static constexpr size_t kBucketSize = BucketSize;
+
+  explicit BlockingQueue(size_t capacity);
+  BlockingQueue(const BlockingQueue& other) = delete;
+  BlockingQueue& operator=(const BlockingQueue& other) = delete;
+  ~BlockingQueue();
+
+  // Blocks while the queue is full.
+  template <typename U>
+  void push(U&& value);
+  // Return false instead of pushing if the queue stays full.
+  template <typename U>
+  bool try_push(U&& value);
+  template <typename U, typename Rep, typename Period>
+  bool push_for(U&& value, const std::chrono::duration<Rep, Period>& timeout);
+
+  // Blocks while the queue is empty.
+  T pop();
+  // Return nothing if the queue stays empty.
+  std::optional<T> try_pop();
+  template <typename Rep, typename Period>
+  std::optional<T> pop_for(const std::chrono::duration<Rep, Period>& timeout);
+
+  // Pushes the whole range, blocking whenever the queue is full and taking
+  // the tail lock once per run of free slots.
+  template <std::input_iterator InputIt>
+  void push_range(InputIt first, InputIt last);
+  // Waits for at least one element, then moves up to max_count elements to
+  // out under a single lock. Returns how many were popped, 0 on timeout.
+  template <typename OutputIt>
+  size_t pop_range(OutputIt out, size_t max_count);
+  template <typename OutputIt, typename Rep, typename Period>
+  size_t pop_range_for(OutputIt out, size_t max_count,
+                       const std::chrono::duration<Rep, Period>& timeout);
+
+  size_t size() const;
+  bool empty() const;
+  size_t capacity() const;
+
+ private:
+  using Deadline = std::optional<std::chrono::steady_clock::time_point>;
+
+  struct Bucket {
+    T* slot(size_t index) {
+      return std::launder(reinterpret_cast<T*>(storage)) + index;
+    }
+
+    alignas(T) unsigned char storage[kBucketSize * sizeof(T)];
+    Bucket* next = nullptr;
+  };
+
+  template <typename Rep, typename Period>
+  static Deadline deadline_after(
+      const std::chrono::duration<Rep, Period>& timeout);
+  template <typename Predicate>
+  static bool wait(std::condition_variable& condition,
+                   std::unique_lock<std::mutex>& lock, const Deadline& deadline,
+                   Predicate ready);
+
+  template <typename U>
+  bool push_one(U&& value, const Deadline& deadline);
+  template <typename Sink>
+  size_t pop_n(size_t max_count, const Deadline& deadline, Sink sink);
+  template <typename U>
+  void emplace_tail(U&& value);
+  T take_head();
+  Bucket* new_bucket();
+  void release_bucket(Bucket* bucket);
+  void notify_not_empty();
+  void notify_not_full();
+
+  const size_t capacity_;
+  std::atomic<size_t> count_{0};
+  std::atomic<Bucket*> spare_bucket_{nullptr};
+
+  alignas(64) std::mutex head_mutex_;
+  std::condition_variable not_empty_;
+  Bucket* head_bucket_;
+  size_t head_index_ = 0;
+
+  alignas(64) std::mutex tail_mutex_;
+  std::condition_variable not_full_;
+  Bucket* tail_bucket_;
+  size_t tail_index_ = 0;
+};
+
+template <typename T, size_t BucketSize>
+BlockingQueue<T, BucketSize>::BlockingQueue(size_t capacity)
+    : capacity_(capacity) {
+  if (capacity == 0) {
+    throw std::invalid_argument("queue capacity must be positive");
+  }
+  head_bucket_ = tail_bucket_ = new Bucket;
+}
+
+template <typename T, size_t BucketSize>
+BlockingQueue<T, BucketSize>::~BlockingQueue() {
+  for (size_t left = count_.load(std::memory_order_relaxed); left > 0;
+       --left) {
+    take_head();
+  }
+  while (head_bucket_ != nullptr) {
+    delete std::exchange(head_bucket_, head_bucket_->next);
+  }
+  delete spare_bucket_.load(std::memory_order_relaxed);
+}
+
+template <typename T, size_t BucketSize>
+template <typename U>
+void BlockingQueue<T, BucketSize>::push(U&& value) {
+  push_one(std::forward<U>(value), std::nullopt);
+}
+
+template <typename T, size_t BucketSize>
+template <typename U>
+bool BlockingQueue<T, BucketSize>::try_push(U&& value) {
+  return push_one(std::forward<U>(value), std::chrono::steady_clock::now());
+}
+
+template <typename T, size_t BucketSize>
+template <typename U, typename Rep, typename Period>
+bool BlockingQueue<T, BucketSize>::push_for(
+    U&& value, const std::chrono::duration<Rep, Period>& timeout) {
+  return push_one(std::forward<U>(value), deadline_after(timeout));
+}
+
+template <typename T, size_t BucketSize>
+T BlockingQueue<T, BucketSize>::pop() {
+  std::optional<T> value;
+  pop_n(1, std::nullopt, [&value](T&& element) {
+    value.emplace(std::move(element));
+  });
+  return std::move(*value);
+}
+
+template <typename T, size_t BucketSize>
+std::optional<T> BlockingQueue<T, BucketSize>::try_pop() {
+  std::optional<T> value;
+  pop_n(1, std::chrono::steady_clock::now(), [&value](T&& element) {
+    value.emplace(std::move(element));
+  });
+  return value;
+}
+
+template <typename T, size_t BucketSize>
+template <typename Rep, typename Period>
+std::optional<T> BlockingQueue<T, BucketSize>::pop_for(
+    const std::chrono::duration<Rep, Period>& timeout) {
+  std::optional<T> value;
+  pop_n(1, deadline_after(timeout), [&value](T&& element) {
+    value.emplace(std::move(element));
+  });
+  return value;
+}
+
+template <typename T, size_t BucketSize>
+template <std::input_iterator InputIt>
+void BlockingQueue<T, BucketSize>::push_range(InputIt first, InputIt last) {
+  while (first != last) {
+    size_t pushed = 0;
+    size_t before = 0;
+    {
+      std::unique_lock<std::mutex> lock(tail_mutex_);
+      wait(not_full_, lock, std::nullopt, [this] {
+        return count_.load(std::memory_order_acquire) < capacity_;
+      });
+      size_t room = capacity_ - count_.load(std::memory_order_acquire);
+      try {
+        for (; pushed < room && first != last; ++pushed, ++first) {
+          emplace_tail(*first);
+        }
+      } catch (...) {
+        before = count_.fetch_add(pushed, std::memory_order_acq_rel);
+        lock.unlock();
+        if (before == 0 && pushed > 0) {
+          notify_not_empty();
+        }
+        throw;
+      }
+      before = count_.fetch_add(pushed, std::memory_order_acq_rel);
+      if (before + pushed < capacity_) {
+        not_full_.notify_one();
+      }
+    }
+    if (before == 0) {
+      notify_not_empty();
+    }
+  }
+}
+
+template <typename T, size_t BucketSize>
+template <typename OutputIt>
+size_t BlockingQueue<T, BucketSize>::pop_range(OutputIt out,
+                                               size_t max_count) {
+  return pop_n(max_count, std::nullopt, [&out](T&& element) {
+    *out = std::move(element);
+    ++out;
+  });
+}
+
+template <typename T, size_t BucketSize>
+template <typename OutputIt, typename Rep, typename Period>
+size_t BlockingQueue<T, BucketSize>::pop_range_for(
+    OutputIt out, size_t max_count,
+    const std::chrono::duration<Rep, Period>& timeout) {
+  return pop_n(max_count, deadline_after(timeout), [&out](T&& element) {
+    *out = std::move(element);
+    ++out;
+  });
+}
+
+template <typename T, size_t BucketSize>
+size_t BlockingQueue<T, BucketSize>::size() const {
+  return count_.load(std::memory_order_acquire);
+}
+
+template <typename T, size_t BucketSize>
+bool BlockingQueue<T, BucketSize>::empty() const {
+  return size() == 0;
+}
+
+template <typename T, size_t BucketSize>
+size_t BlockingQueue<T, BucketSize>::capacity() const {
+  return capacity_;
+}
+
+template <typename T, size_t BucketSize>
+template <typename Rep, typename Period>
+typename BlockingQueue<T, BucketSize>::Deadline
+BlockingQueue<T, BucketSize>::deadline_after(
+    const std::chrono::duration<Rep, Period>& timeout) {
+  return std::chrono::steady_clock::now() +
+         std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+}
+
+template <typename T, size_t BucketSize>
+template <typename Predicate>
+bool BlockingQueue<T, BucketSize>::wait(std::condition_variable& condition,
+                                        std::unique_lock<std::mutex>& lock,
+                                        const Deadline& deadline,
+                                        Predicate ready) {
+  if (!deadline) {
+    condition.wait(lock, ready);
+    return true;
+  }
+  return condition.wait_until(lock, *deadline, ready);
+}
+
+// Producers only wait on a full queue and consumers on an empty one, so each
+// side wakes the other only on those transitions and otherwise passes the
+// signal along to the next waiter of its own kind.
+template <typename T, size_t BucketSize>
+template <typename U>
+bool BlockingQueue<T, BucketSize>::push_one(U&& value,
+                                            const Deadline& deadline) {
+  size_t before = 0;
+  {
+    std::unique_lock<std::mutex> lock(tail_mutex_);
+    if (!wait(not_full_, lock, deadline, [this] {
+          return count_.load(std::memory_order_acquire) < capacity_;
+        })) {
+      return false;
+    }
+    emplace_tail(std::forward<U>(value));
+    before = count_.fetch_add(1, std::memory_order_acq_rel);
+    if (before + 1 < capacity_) {
+      not_full_.notify_one();
+    }
+  }
+  if (before == 0) {
+    notify_not_empty();
+  }
+  return true;
+}
+
+template <typename T, size_t BucketSize>
+template <typename Sink>
+size_t BlockingQueue<T, BucketSize>::pop_n(size_t max_count,
+                                           const Deadline& deadline,
+                                           Sink sink) {
+  if (max_count == 0) {
+    return 0;
+  }
+  size_t taken = 0;
+  size_t before = 0;
+  {
+    std::unique_lock<std::mutex> lock(head_mutex_);
+    if (!wait(not_empty_, lock, deadline, [this] {
+          return count_.load(std::memory_order_acquire) > 0;
+        })) {
+      return 0;
+    }
+    size_t available =
+        std::min(max_count, count_.load(std::memory_order_acquire));
+    try {
+      for (; taken < available; ++taken) {
+        sink(take_head());
+      }
+    } catch (...) {
+      // take_head() leaves the element queued if it throws; one whose move
+      // into the sink threw is lost.
+      before = count_.fetch_sub(taken, std::memory_order_acq_rel);
+      if (before > taken) {
+        not_empty_.notify_one();
+      }
+      lock.unlock();
+      if (before == capacity_ && taken > 0) {
+        notify_not_full();
+      }
+      throw;
+    }
+    before = count_.fetch_sub(taken, std::memory_order_acq_rel);
+    if (before > taken) {
+      not_empty_.notify_one();
+    }
+  }
+  if (before == capacity_) {
+    notify_not_full();
+  }
+  return taken;
+}
+
+template <typename T, size_t BucketSize>
+template <typename U>
+void BlockingQueue<T, BucketSize>::emplace_tail(U&& value) {
+  if (tail_index_ == kBucketSize) {
+    Bucket* bucket = new_bucket();
+    tail_bucket_->next = bucket;
+    tail_bucket_ = bucket;
+    tail_index_ = 0;
+  }
+  std::construct_at(tail_bucket_->slot(tail_index_), std::forward<U>(value));
+  ++tail_index_;
+}
+
+template <typename T, size_t BucketSize>
+T BlockingQueue<T, BucketSize>::take_head() {
+  if (head_index_ == kBucketSize) {
+    Bucket* next = head_bucket_->next;
+    release_bucket(head_bucket_);
+    head_bucket_ = next;
+    head_index_ = 0;
+  }
+  T* slot = head_bucket_->slot(head_index_);
+  T value(std::move(*slot));
+  std::destroy_at(slot);
+  ++head_index_;
+  return value;
+}
+
+// One drained bucket is parked for the producers to reuse, so a queue that
+// stays short does not allocate in steady state.
+template <typename T, size_t BucketSize>
+typename BlockingQueue<T, BucketSize>::Bucket*
+BlockingQueue<T, BucketSize>::new_bucket() {
+  Bucket* bucket = spare_bucket_.exchange(nullptr, std::memory_order_acq_rel);
+  if (bucket == nullptr) {
+    return new Bucket;
+  }
+  bucket->next = nullptr;
+  return bucket;
+}
+
+template <typename T, size_t BucketSize>
+void BlockingQueue<T, BucketSize>::release_bucket(Bucket* bucket) {
+  delete spare_bucket_.exchange(bucket, std::memory_order_acq_rel);
+}
+
+template <typename T, size_t BucketSize>
+void BlockingQueue<T, BucketSize>::notify_not_empty() {
+  std::lock_guard<std::mutex> lock(head_mutex_);
+  not_empty_.notify_one();
+}
+
+template <typename T, size_t BucketSize>
+void BlockingQueue<T, BucketSize>::notify_not_full() {
+  std::lock_guard<std::mutex> lock(tail_mutex_);
+  not_full_.notify_one();
+}
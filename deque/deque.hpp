@@ -1,17 +1,37 @@
+#pragma once
+
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <numeric>
+#include <span>
 #include <stdexcept>
 #include <type_traits>
 #include <vector>
 
-const int kSize = 32;
+const size_t kDequeBucketBytes = 4096;
+const size_t kDequeMinBucketSize = 16;
+const size_t kDequeSpareBuckets = 2;
+
+// Elements per bucket: as many as fit in kDequeBucketBytes, but never fewer
+// than kDequeMinBucketSize, rounded down to a power of two.
+template <typename T>
+constexpr size_t DequeBucketSize() {
+  return std::bit_floor(std::max(kDequeMinBucketSize,
+                                 kDequeBucketBytes / sizeof(T)));
+}
 
-template <typename T, typename Allocator = std::allocator<T>>
+template <typename T, typename Allocator = std::allocator<T>,
+          size_t BucketSize = DequeBucketSize<T>()>
 class Deque {
  public:
   using allocator_type = Allocator;
+  static constexpr size_t kBucketSize = BucketSize;
+  static constexpr size_t kBucketShift = std::countr_zero(BucketSize);
+  static constexpr size_t kBucketMask = BucketSize - 1;
 
   Deque() = default;
   Deque(std::initializer_list<T> init, const Allocator& alloc = Allocator());
@@ -20,19 +40,32 @@ class Deque {
   Deque(Deque&& other) noexcept;
   Deque(size_t count, const Allocator& alloc = Allocator());
   Deque(size_t count, const T& value, const Allocator& alloc = Allocator());
+  template <std::input_iterator InputIt>
+  Deque(InputIt first, InputIt last, const Allocator& alloc = Allocator());
   ~Deque();
 
   Deque& operator=(const Deque& other);
   Deque& operator=(Deque&& other) noexcept;
   void swap(Deque& new_deque) noexcept;
+  void assign(size_t count, const T& value);
+  template <std::input_iterator InputIt>
+  void assign(InputIt first, InputIt last);
+  void assign(std::initializer_list<T> init);
 
   size_t size() const;
   bool empty() const;
+  void shrink_to_fit();
+  void resize(size_t count);
+  void resize(size_t count, const T& value);
+  void set_max_spare_buckets(size_t count);
 
   T& operator[](size_t index);
   const T& operator[](size_t index) const;
   T& at(size_t index);
   const T& at(size_t index) const;
+  size_t segment_count() const;
+  std::span<T> segment(size_t index);
+  std::span<const T> segment(size_t index) const;
   void push_back();
   void push_back(const T& element);
   void push_back(T&& element);
@@ -52,25 +85,30 @@ class Deque {
     using value_type = T;
     using pointer = std::conditional_t<IsConst, const T*, T*>;
     using reference = std::conditional_t<IsConst, const T&, T&>;
+    using difference_type = std::ptrdiff_t;
     using iterator_category = std::random_access_iterator_tag;
 
-    Iterator(T** bucket_ptr, int bucket, int index, int bucket_size);
-    Iterator(const T* const* bucket_ptr, int bucket, int index,
-             int bucket_size);
+    Iterator() = default;
+    Iterator(T** map, size_t position);
+    Iterator(const T* const* map, size_t position);
 
     reference operator*() const;
     pointer operator->() const;
+    reference operator[](difference_type n) const;
 
     Iterator& operator++();
     Iterator operator++(int);
     Iterator& operator--();
     Iterator operator--(int);
 
-    Iterator& operator+=(size_t n);
-    Iterator operator+(size_t n) const;
-    Iterator& operator-=(size_t n);
-    Iterator operator-(size_t n) const;
-    int operator-(const Iterator& other) const;
+    Iterator& operator+=(difference_type n);
+    Iterator operator+(difference_type n) const;
+    friend Iterator operator+(difference_type n, const Iterator& it) {
+      return it + n;
+    }
+    Iterator& operator-=(difference_type n);
+    Iterator operator-(difference_type n) const;
+    difference_type operator-(const Iterator& other) const;
 
     bool operator==(const Iterator& other) const;
     bool operator!=(const Iterator& other) const;
@@ -79,11 +117,16 @@ class Deque {
     bool operator<=(const Iterator& other) const;
     bool operator>=(const Iterator& other) const;
 
+    // Calls func(begin, end) on each contiguous run of [*this, last) in order
+    // until it returns false; returns whether it never did.
+    template <typename Func>
+    bool for_each_segment(const Iterator& last, Func func) const;
+
    private:
-    size_t index_;
-    size_t bucket_;
-    T** bucket_ptr_;
-    size_t bucket_size_;
+    // An element is addressed by its position counted from the start of the
+    // bucket map, so all arithmetic is on one integer and never branches.
+    T** map_ = nullptr;
+    size_t position_ = 0;
   };
 
   using iterator = Iterator<false>;
@@ -97,70 +140,83 @@ class Deque {
   reverse_iterator rbegin();
   reverse_iterator rend();
 
+  template <typename... Args>
+  iterator emplace(iterator pos, Args&&... args);
   iterator insert(iterator pos, const T& value);
   iterator insert(iterator pos, T&& value);
-  void erase(iterator pos);
+  iterator insert(iterator pos, size_t count, const T& value);
+  template <std::input_iterator InputIt>
+  iterator insert(iterator pos, InputIt first, InputIt last);
+  iterator erase(iterator pos);
+  iterator erase(iterator first, iterator last);
 
  private:
+  static_assert(std::has_single_bit(BucketSize),
+                "bucket size must be a power of two");
+
   std::vector<T*> buckets_;
-  size_t bucket_size_ = kSize;
   size_t first_bucket_ = 0;
   size_t last_bucket_ = 0;
   size_t first_index_ = 0;
   size_t last_index_ = 0;
   size_t size_ = 0;
+  std::vector<T*> spare_buckets_;
+  size_t max_spare_buckets_ = kDequeSpareBuckets;
   [[no_unique_address]] Allocator alloc_;
 
   using alloc_traits = std::allocator_traits<Allocator>;
 
   void new_bucket(int index);
   void delete_bucket(int index);
-  void realloc();
+  void realloc(bool at_front);
+  template <typename Source>
+  iterator insert_n(size_t index, size_t count, Source source);
+  template <typename Fill>
+  void append_n(size_t count, Fill fill, size_t first_index = 0);
+  template <typename... Args>
+  void construct_bucket(T* dest, size_t count, const Args&... args);
+  template <typename InputIt>
+  InputIt copy_bucket(InputIt src, size_t count, T* dest);
   void initialize_first_element();
   void clear();
+  void free_spare_buckets();
 };
-template <typename T, typename Allocator>
-Deque<T, Allocator>::Deque(std::initializer_list<T> init,
-                           const Allocator& alloc)
-    : alloc_(alloc) {
-  try {
-    for (auto elem : init) {
-      push_back(std::move(elem));
-    }
-  } catch (...) {
-    clear();
-    throw;
-  }
-}
-template <typename T, typename Allocator>
-Deque<T, Allocator>::Deque(const Deque& other)
-    : alloc_(alloc_traits::select_on_container_copy_construction(other.alloc_)),
-      buckets_(other.buckets_.size(), nullptr) {
-  if (other.empty()) {
-    return;
-  }
-  size_ = 0;
-  first_bucket_ = last_bucket_ = first_index_ = last_index_ = 0;
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>::Deque(std::initializer_list<T> init,
+                                       const Allocator& alloc)
+    : Deque(init.begin(), init.end(), alloc) {}
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>::Deque(const Deque& other)
+    : max_spare_buckets_(other.max_spare_buckets_),
+      alloc_(
+          alloc_traits::select_on_container_copy_construction(other.alloc_)) {
+  // Mirror the layout of other so every bucket is copied from one segment.
+  size_t segment = 0;
   try {
-    for (size_t i = 0; i < other.size(); ++i) {
-      push_back(other[i]);
-    }
+    append_n(
+        other.size_,
+        [this, &other, &segment](T* dest, size_t count) {
+          copy_bucket(other.segment(segment++).data(), count, dest);
+        },
+        other.first_index_);
   } catch (...) {
     clear();
+    free_spare_buckets();
     throw;
   }
 }
 
-template <typename T, typename Allocator>
-Deque<T, Allocator>::Deque(Deque&& other) noexcept
-    : alloc_(std::move(other.alloc_)),
-      buckets_(std::move(other.buckets_)),
-      bucket_size_(other.bucket_size_),
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>::Deque(Deque&& other) noexcept
+    : buckets_(std::move(other.buckets_)),
       first_bucket_(other.first_bucket_),
       last_bucket_(other.last_bucket_),
       first_index_(other.first_index_),
       last_index_(other.last_index_),
-      size_(other.size_) {
+      size_(other.size_),
+      spare_buckets_(std::move(other.spare_buckets_)),
+      max_spare_buckets_(other.max_spare_buckets_),
+      alloc_(std::move(other.alloc_)) {
   other.size_ = 0;
   other.first_bucket_ = 0;
   other.last_bucket_ = 0;
@@ -168,51 +224,55 @@ Deque<T, Allocator>::Deque(Deque&& other) noexcept
   other.last_index_ = 0;
 }
 
-template <typename T, typename Allocator>
-Deque<T, Allocator>::Deque(size_t count, const Allocator& alloc)
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>::Deque(size_t count, const Allocator& alloc)
     : alloc_(alloc) {
-  if (count == 0) {
-    return;
-  }
   try {
-    for (size_t i = 0; i < count; ++i) {
-      push_back();
-    }
+    append_n(count,
+             [this](T* dest, size_t n) { construct_bucket(dest, n); });
   } catch (...) {
     clear();
+    free_spare_buckets();
     throw;
   }
 }
-template <typename T, typename Allocator>
-Deque<T, Allocator>::Deque(size_t count, const T& value, const Allocator& alloc)
-    : alloc_(alloc), size_(count) {
-  if (count == 0) {
-    buckets_ = std::vector<T*>(0);
-    return;
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>::Deque(size_t count, const T& value,
+                                       const Allocator& alloc)
+    : alloc_(alloc) {
+  try {
+    append_n(count, [this, &value](T* dest, size_t n) {
+      construct_bucket(dest, n, value);
+    });
+  } catch (...) {
+    clear();
+    free_spare_buckets();
+    throw;
   }
-  buckets_ = std::vector<T*>(0);
-  first_bucket_ = 0;
-  last_bucket_ = 0;
-  first_index_ = 0;
-  last_index_ = 0;
-  size_ = 0;
+}
+template <typename T, typename Allocator, size_t BucketSize>
+template <std::input_iterator InputIt>
+Deque<T, Allocator, BucketSize>::Deque(InputIt first, InputIt last,
+                                       const Allocator& alloc)
+    : alloc_(alloc) {
   try {
-    for (size_t i = 0; i < count; ++i) {
-      push_back(value);
-    }
+    assign(first, last);
   } catch (...) {
     clear();
+    free_spare_buckets();
     throw;
   }
 }
 
-template <typename T, typename Allocator>
-Deque<T, Allocator>::~Deque() {
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>::~Deque() {
   clear();
+  free_spare_buckets();
 }
 
-template <typename T, typename Allocator>
-Deque<T, Allocator>& Deque<T, Allocator>::operator=(const Deque& other) {
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>& Deque<T, Allocator, BucketSize>::operator=(
+    const Deque& other) {
   if (this != &other) {
     Deque tmp(other);
     if (alloc_traits::propagate_on_container_copy_assignment::value) {
@@ -223,8 +283,9 @@ Deque<T, Allocator>& Deque<T, Allocator>::operator=(const Deque& other) {
   return *this;
 }
 
-template <typename T, typename Allocator>
-Deque<T, Allocator>& Deque<T, Allocator>::operator=(Deque&& other) noexcept {
+template <typename T, typename Allocator, size_t BucketSize>
+Deque<T, Allocator, BucketSize>& Deque<T, Allocator, BucketSize>::operator=(
+    Deque&& other) noexcept {
   if (&other == this) {
     return *this;
   }
@@ -236,97 +297,179 @@ Deque<T, Allocator>& Deque<T, Allocator>::operator=(Deque&& other) noexcept {
   return *this;
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::swap(Deque& new_deque) noexcept {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::swap(Deque& new_deque) noexcept {
   std::swap(buckets_, new_deque.buckets_);
   std::swap(size_, new_deque.size_);
   std::swap(first_bucket_, new_deque.first_bucket_);
   std::swap(last_bucket_, new_deque.last_bucket_);
   std::swap(first_index_, new_deque.first_index_);
   std::swap(last_index_, new_deque.last_index_);
+  std::swap(spare_buckets_, new_deque.spare_buckets_);
+  std::swap(max_spare_buckets_, new_deque.max_spare_buckets_);
   if constexpr (alloc_traits::propagate_on_container_swap::value) {
     std::swap(alloc_, new_deque.alloc_);
   }
 }
 
-template <typename T, typename Allocator>
-size_t Deque<T, Allocator>::size() const {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::assign(size_t count, const T& value) {
+  clear();
+  append_n(count, [this, &value](T* dest, size_t n) {
+    construct_bucket(dest, n, value);
+  });
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+template <std::input_iterator InputIt>
+void Deque<T, Allocator, BucketSize>::assign(InputIt first, InputIt last) {
+  clear();
+  if constexpr (std::forward_iterator<InputIt>) {
+    append_n(std::distance(first, last), [this, &first](T* dest, size_t n) {
+      first = copy_bucket(first, n, dest);
+    });
+  } else {
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::assign(std::initializer_list<T> init) {
+  assign(init.begin(), init.end());
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+size_t Deque<T, Allocator, BucketSize>::size() const {
   return size_;
 }
 
-template <typename T, typename Allocator>
-bool Deque<T, Allocator>::empty() const {
+template <typename T, typename Allocator, size_t BucketSize>
+bool Deque<T, Allocator, BucketSize>::empty() const {
   return size_ == 0;
 }
 
-template <typename T, typename Allocator>
-T& Deque<T, Allocator>::operator[](size_t index) {
-  if (last_bucket_ == first_bucket_) {
-    return buckets_[first_bucket_][first_index_ + index];
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::shrink_to_fit() {
+  free_spare_buckets();
+  spare_buckets_.shrink_to_fit();
+  if (empty()) {
+    buckets_.shrink_to_fit();
+    return;
   }
-  size_t elem_first_bucket = bucket_size_ - first_index_;
-  if (index + 1 <= elem_first_bucket) {
-    return buckets_[first_bucket_][first_index_ + index];
+  std::vector<T*> new_vec(buckets_.begin() + first_bucket_,
+                          buckets_.begin() + last_bucket_ + 1);
+  buckets_.swap(new_vec);
+  last_bucket_ -= first_bucket_;
+  first_bucket_ = 0;
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::resize(size_t count) {
+  if (count < size_) {
+    erase(begin() + count, end());
+    return;
   }
-  index -= elem_first_bucket;
-  return buckets_[first_bucket_ + 1 + index / bucket_size_]
-                 [index % bucket_size_];
+  append_n(count - size_,
+           [this](T* dest, size_t n) { construct_bucket(dest, n); });
 }
 
-template <typename T, typename Allocator>
-const T& Deque<T, Allocator>::operator[](size_t index) const {
-  if (last_bucket_ == first_bucket_) {
-    return buckets_[first_bucket_][first_index_ + index];
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::resize(size_t count, const T& value) {
+  if (count < size_) {
+    erase(begin() + count, end());
+    return;
   }
-  size_t elem_first_bucket = bucket_size_ - first_index_;
-  if (index + 1 <= elem_first_bucket) {
-    return buckets_[first_bucket_][first_index_ + index];
+  append_n(count - size_, [this, &value](T* dest, size_t n) {
+    construct_bucket(dest, n, value);
+  });
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+size_t Deque<T, Allocator, BucketSize>::segment_count() const {
+  return size_ == 0 ? 0 : last_bucket_ - first_bucket_ + 1;
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+std::span<T> Deque<T, Allocator, BucketSize>::segment(size_t index) {
+  size_t bucket = first_bucket_ + index;
+  size_t begin = index == 0 ? first_index_ : 0;
+  size_t end = bucket == last_bucket_ ? last_index_ + 1 : kBucketSize;
+  return std::span<T>(buckets_[bucket] + begin, end - begin);
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+std::span<const T> Deque<T, Allocator, BucketSize>::segment(
+    size_t index) const {
+  size_t bucket = first_bucket_ + index;
+  size_t begin = index == 0 ? first_index_ : 0;
+  size_t end = bucket == last_bucket_ ? last_index_ + 1 : kBucketSize;
+  return std::span<const T>(buckets_[bucket] + begin, end - begin);
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::set_max_spare_buckets(size_t count) {
+  max_spare_buckets_ = count;
+  while (spare_buckets_.size() > count) {
+    alloc_traits::deallocate(alloc_, spare_buckets_.back(), kBucketSize);
+    spare_buckets_.pop_back();
   }
-  index -= elem_first_bucket;
-  return buckets_[first_bucket_ + 1 + index / bucket_size_]
-                 [index % bucket_size_];
+  spare_buckets_.reserve(count);
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+T& Deque<T, Allocator, BucketSize>::operator[](size_t index) {
+  size_t position = (first_bucket_ << kBucketShift) + first_index_ + index;
+  return buckets_[position >> kBucketShift][position & kBucketMask];
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+const T& Deque<T, Allocator, BucketSize>::operator[](size_t index) const {
+  size_t position = (first_bucket_ << kBucketShift) + first_index_ + index;
+  return buckets_[position >> kBucketShift][position & kBucketMask];
 }
 
-template <typename T, typename Allocator>
-T& Deque<T, Allocator>::at(size_t index) {
+template <typename T, typename Allocator, size_t BucketSize>
+T& Deque<T, Allocator, BucketSize>::at(size_t index) {
   if (index >= size_) {
     throw std::out_of_range("bad index");
   }
   return (*this)[index];
 }
 
-template <typename T, typename Allocator>
-const T& Deque<T, Allocator>::at(size_t index) const {
+template <typename T, typename Allocator, size_t BucketSize>
+const T& Deque<T, Allocator, BucketSize>::at(size_t index) const {
   if (index >= size_) {
     throw std::out_of_range("bad index");
   }
   return (*this)[index];
 }
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::push_back() {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::push_back() {
   emplace_back();
 }
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::push_back(const T& element) {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::push_back(const T& element) {
   emplace_back(element);
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::push_back(T&& element) {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::push_back(T&& element) {
   emplace_back(std::move(element));
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::pop_back() {
-  if (buckets_[last_bucket_] != nullptr) {
-    alloc_traits::destroy(alloc_, buckets_[last_bucket_] + last_index_);
-  }
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::pop_back() {
   if (size_ == 1) {
     clear();
     return;
   }
+  if (buckets_[last_bucket_] != nullptr) {
+    alloc_traits::destroy(alloc_, buckets_[last_bucket_] + last_index_);
+  }
   if (last_index_ == 0) {
-    last_index_ = bucket_size_ - 1;
+    last_index_ = kBucketSize - 1;
     if (first_bucket_ != last_bucket_ && buckets_[last_bucket_] != nullptr) {
       delete_bucket(last_bucket_);
     }
@@ -337,26 +480,26 @@ void Deque<T, Allocator>::pop_back() {
   --size_;
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::push_front(const T& element) {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::push_front(const T& element) {
   emplace_front(element);
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::push_front(T&& element) {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::push_front(T&& element) {
   emplace_front(std::move(element));
 }
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::pop_front() {
-  if (buckets_[first_bucket_] != nullptr) {
-    alloc_traits::destroy(alloc_, buckets_[first_bucket_] + first_index_);
-  }
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::pop_front() {
   if (size_ == 1) {
     clear();
     return;
   }
+  if (buckets_[first_bucket_] != nullptr) {
+    alloc_traits::destroy(alloc_, buckets_[first_bucket_] + first_index_);
+  }
   ++first_index_;
-  if (first_index_ == bucket_size_) {
+  if (first_index_ == kBucketSize) {
     first_index_ = 0;
     if (first_bucket_ != last_bucket_ && buckets_[first_bucket_] != nullptr) {
       delete_bucket(first_bucket_);
@@ -365,9 +508,9 @@ void Deque<T, Allocator>::pop_front() {
   }
   --size_;
 }
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <typename... Args>
-void Deque<T, Allocator>::emplace_back(Args&&... args) {
+void Deque<T, Allocator, BucketSize>::emplace_back(Args&&... args) {
   if (empty()) {
     initialize_first_element();
     try {
@@ -382,12 +525,12 @@ void Deque<T, Allocator>::emplace_back(Args&&... args) {
       throw;
     }
   }
-  if (last_bucket_ == buckets_.size() - 1) {
-    realloc();
+  if (last_index_ == kBucketSize - 1 && last_bucket_ == buckets_.size() - 1) {
+    realloc(false);
   }
   ++last_index_;
   ++size_;
-  if (last_index_ == bucket_size_) {
+  if (last_index_ == kBucketSize) {
     ++last_bucket_;
     last_index_ = 0;
     new_bucket(last_bucket_);
@@ -400,7 +543,7 @@ void Deque<T, Allocator>::emplace_back(Args&&... args) {
                             std::forward<Args>(args)...);
   } catch (...) {
     if (last_index_ == 0) {
-      last_index_ = bucket_size_;
+      last_index_ = kBucketSize;
       if (buckets_[last_bucket_] != nullptr && last_bucket_ != first_bucket_) {
         delete_bucket(last_bucket_);
       }
@@ -411,9 +554,9 @@ void Deque<T, Allocator>::emplace_back(Args&&... args) {
     throw;
   }
 }
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <typename... Args>
-void Deque<T, Allocator>::emplace_front(Args&&... args) {
+void Deque<T, Allocator, BucketSize>::emplace_front(Args&&... args) {
   if (empty()) {
     initialize_first_element();
     try {
@@ -426,13 +569,13 @@ void Deque<T, Allocator>::emplace_front(Args&&... args) {
       throw;
     }
   }
-  if (first_bucket_ == 0) {
-    realloc();
+  if (first_index_ == 0 && first_bucket_ == 0) {
+    realloc(true);
   }
   if (first_index_ == 0) {
     --first_bucket_;
     new_bucket(first_bucket_);
-    first_index_ = bucket_size_;
+    first_index_ = kBucketSize;
   }
   first_index_--;
   ++size_;
@@ -443,7 +586,7 @@ void Deque<T, Allocator>::emplace_front(Args&&... args) {
     alloc_traits::construct(alloc_, buckets_[first_bucket_] + first_index_,
                             std::forward<Args>(args)...);
   } catch (...) {
-    if (first_index_ == bucket_size_ - 1) {
+    if (first_index_ == kBucketSize - 1) {
       if (buckets_[first_bucket_] != nullptr) {
         delete_bucket(first_bucket_);
       }
@@ -455,294 +598,517 @@ void Deque<T, Allocator>::emplace_front(Args&&... args) {
     throw;
   }
 }
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-Deque<T, Allocator>::Iterator<IsConst>::Iterator(T** bucket_ptr, int bucket,
-                                                 int index, int bucket_size)
-    : bucket_ptr_(bucket_ptr),
-      index_(index),
-      bucket_(bucket),
-      bucket_size_(bucket_size) {}
-
-template <typename T, typename Allocator>
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::Iterator(T** map,
+                                                             size_t position)
+    : map_(map), position_(position) {}
+
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-Deque<T, Allocator>::Iterator<IsConst>::Iterator(const T* const* bucket_ptr,
-                                                 int bucket, int index,
-                                                 int bucket_size)
-    : bucket_ptr_(const_cast<T**>(bucket_ptr)),
-      index_(index),
-      bucket_(bucket),
-      bucket_size_(bucket_size) {}
-
-template <typename T, typename Allocator>
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::Iterator(
+    const T* const* map, size_t position)
+    : map_(const_cast<T**>(map)), position_(position) {}
+
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>::reference
-Deque<T, Allocator>::Iterator<IsConst>::operator*() const {
-  return bucket_ptr_[bucket_][index_];
+template <typename Func>
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::for_each_segment(
+    const Iterator& last, Func func) const {
+  size_t position = position_;
+  while (position < last.position_) {
+    size_t index = position & kBucketMask;
+    size_t count = std::min(kBucketSize - index, last.position_ - position);
+    pointer data = map_[position >> kBucketShift] + index;
+    if (!func(data, data + count)) {
+      return false;
+    }
+    position += count;
+  }
+  return true;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>::pointer
-Deque<T, Allocator>::Iterator<IsConst>::operator->() const {
-  return &bucket_ptr_[bucket_][index_];
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>::reference
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator*() const {
+  return map_[position_ >> kBucketShift][position_ & kBucketMask];
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>&
-Deque<T, Allocator>::Iterator<IsConst>::operator++() {
-  ++index_;
-  if (index_ == bucket_size_) {
-    index_ = 0;
-    ++bucket_;
-  }
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>::pointer
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator->() const {
+  return &**this;
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+template <bool IsConst>
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>::reference
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator[](
+    difference_type n) const {
+  return *(*this + n);
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+template <bool IsConst>
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>&
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator++() {
+  ++position_;
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>
-Deque<T, Allocator>::Iterator<IsConst>::operator++(int) {
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator++(int) {
   Iterator tmp = *this;
   ++(*this);
   return tmp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>&
-Deque<T, Allocator>::Iterator<IsConst>::operator--() {
-  if (index_ == 0) {
-    index_ = bucket_size_ - 1;
-    --bucket_;
-  } else {
-    --index_;
-  }
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>&
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator--() {
+  --position_;
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>
-Deque<T, Allocator>::Iterator<IsConst>::operator--(int) {
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator--(int) {
   Iterator tmp = *this;
   --(*this);
   return tmp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>&
-Deque<T, Allocator>::Iterator<IsConst>::operator+=(size_t n) {
-  int tmp = bucket_ * bucket_size_ + index_ + n;
-  bucket_ = (tmp) / bucket_size_;
-  index_ = tmp % bucket_size_;
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>&
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator+=(
+    difference_type n) {
+  position_ += n;
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>
-Deque<T, Allocator>::Iterator<IsConst>::operator+(size_t n) const {
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator+(
+    difference_type n) const {
   Iterator tmp = *this;
   tmp += n;
   return tmp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>&
-Deque<T, Allocator>::Iterator<IsConst>::operator-=(size_t n) {
-  size_t tmp = bucket_ * bucket_size_ + index_ - n;
-  bucket_ = (tmp) / bucket_size_;
-  index_ = tmp % bucket_size_;
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>&
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator-=(
+    difference_type n) {
+  position_ -= n;
   return *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-typename Deque<T, Allocator>::template Iterator<IsConst>
-Deque<T, Allocator>::Iterator<IsConst>::operator-(size_t n) const {
+typename Deque<T, Allocator, BucketSize>::template Iterator<IsConst>
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator-(
+    difference_type n) const {
   Iterator tmp = *this;
   tmp -= n;
   return tmp;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-int Deque<T, Allocator>::Iterator<IsConst>::operator-(
+typename Deque<T, Allocator,
+               BucketSize>::template Iterator<IsConst>::difference_type
+Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator-(
     const Iterator& other) const {
-  return (bucket_ * bucket_size_ + index_) -
-         (other.bucket_ * bucket_size_ + other.index_);
+  return static_cast<difference_type>(position_ - other.position_);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-bool Deque<T, Allocator>::Iterator<IsConst>::operator==(
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator==(
     const Iterator& other) const {
-  return bucket_ == other.bucket_ && index_ == other.index_ &&
-         bucket_ptr_ == other.bucket_ptr_;
+  return position_ == other.position_;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-bool Deque<T, Allocator>::Iterator<IsConst>::operator!=(
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator!=(
     const Iterator& other) const {
   return !(*this == other);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-bool Deque<T, Allocator>::Iterator<IsConst>::operator<(
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator<(
     const Iterator& other) const {
-  return bucket_ < other.bucket_ ||
-         (bucket_ == other.bucket_ && index_ < other.index_);
+  return position_ < other.position_;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-bool Deque<T, Allocator>::Iterator<IsConst>::operator>(
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator>(
     const Iterator& other) const {
   return other < *this;
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-bool Deque<T, Allocator>::Iterator<IsConst>::operator<=(
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator<=(
     const Iterator& other) const {
   return !(other < *this);
 }
 
-template <typename T, typename Allocator>
+template <typename T, typename Allocator, size_t BucketSize>
 template <bool IsConst>
-bool Deque<T, Allocator>::Iterator<IsConst>::operator>=(
+bool Deque<T, Allocator, BucketSize>::Iterator<IsConst>::operator>=(
     const Iterator& other) const {
   return !(*this < other);
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::iterator Deque<T, Allocator>::begin() {
-  return iterator(buckets_.data(), first_bucket_, first_index_, bucket_size_);
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::begin() {
+  return iterator(buckets_.data(),
+                  (first_bucket_ << kBucketShift) + first_index_);
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::const_iterator Deque<T, Allocator>::cbegin()
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::const_iterator
+Deque<T, Allocator, BucketSize>::cbegin()
     const {
-  return const_iterator(buckets_.data(), first_bucket_, first_index_,
-                        bucket_size_);
+  return const_iterator(buckets_.data(),
+                        (first_bucket_ << kBucketShift) + first_index_);
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::iterator Deque<T, Allocator>::end() {
-  if (size_ == 0) {
-    return begin();
-  }
-  if (last_index_ == bucket_size_ - 1) {
-    return iterator(buckets_.data(), last_bucket_ + 1, 0, bucket_size_);
-  }
-  return iterator(buckets_.data(), last_bucket_, last_index_ + 1, bucket_size_);
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::end() {
+  return begin() + size_;
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::const_iterator Deque<T, Allocator>::cend() const {
-  if (size_ == 0) {
-    return cbegin();
-  }
-  if (last_index_ == bucket_size_ - 1) {
-    return const_iterator(buckets_.data(), last_bucket_ + 1, 0, bucket_size_);
-  }
-  return const_iterator(buckets_.data(), last_bucket_, last_index_ + 1,
-                        bucket_size_);
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::const_iterator
+Deque<T, Allocator, BucketSize>::cend() const {
+  return cbegin() + size_;
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::reverse_iterator Deque<T, Allocator>::rbegin() {
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::reverse_iterator
+Deque<T, Allocator, BucketSize>::rbegin() {
   return reverse_iterator(end());
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::reverse_iterator Deque<T, Allocator>::rend() {
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::reverse_iterator
+Deque<T, Allocator, BucketSize>::rend() {
   return reverse_iterator(begin());
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::iterator Deque<T, Allocator>::insert(
-    iterator pos, const T& value) {
+template <typename T, typename Allocator, size_t BucketSize>
+template <typename... Args>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::emplace(iterator pos, Args&&... args) {
   if (pos == end()) {
-    push_back(value);
+    emplace_back(std::forward<Args>(args)...);
     return end() - 1;
   }
   if (pos == begin()) {
-    push_front(value);
+    emplace_front(std::forward<Args>(args)...);
     return begin();
   }
+  T value(std::forward<Args>(args)...);
+  return insert_n(pos - begin(), 1,
+                  [&value](size_t) -> T&& { return std::move(value); });
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::insert(iterator pos, const T& value) {
+  return emplace(pos, value);
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::insert(iterator pos, T&& value) {
+  return emplace(pos, std::move(value));
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::insert(iterator pos, size_t count,
+                                        const T& value) {
+  // value may refer to an element of this deque, which the shift overwrites.
+  T copy(value);
+  return insert_n(pos - begin(), count,
+                  [&copy](size_t) -> const T& { return copy; });
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+template <std::input_iterator InputIt>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::insert(iterator pos, InputIt first,
+                                        InputIt last) {
   size_t index = pos - begin();
-  push_back(value);
-  for (size_t i = size_ - 1; i > index; --i) {
-    (*this)[i] = std::move((*this)[i - 1]);
+  if constexpr (std::random_access_iterator<InputIt>) {
+    return insert_n(index, last - first, [first](size_t k) -> decltype(auto) {
+      return first[static_cast<std::iter_difference_t<InputIt>>(k)];
+    });
+  } else {
+    std::vector<T> values(first, last);
+    return insert_n(index, values.size(), [&values](size_t k) -> T&& {
+      return std::move(values[k]);
+    });
   }
-  (*this)[index] = value;
-  return begin() + index;
 }
 
-template <typename T, typename Allocator>
-typename Deque<T, Allocator>::iterator Deque<T, Allocator>::insert(iterator pos,
-                                                                   T&& value) {
-  if (pos == end()) {
-    push_back(std::move(value));
-    return end() - 1;
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::erase(iterator pos) {
+  return erase(pos, pos + 1);
+}
+
+template <typename T, typename Allocator, size_t BucketSize>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::erase(iterator first, iterator last) {
+  size_t index = first - begin();
+  size_t count = last - first;
+  if (count == 0) {
+    return first;
   }
-  if (pos == begin()) {
-    push_front(std::move(value));
-    return begin();
+  // Close the gap from whichever side has fewer elements to move.
+  if (index < size_ - index - count) {
+    std::move_backward(begin(), first, last);
+    for (size_t i = 0; i < count; ++i) {
+      pop_front();
+    }
+  } else {
+    std::move(last, end(), first);
+    for (size_t i = 0; i < count; ++i) {
+      pop_back();
+    }
   }
-  size_t index = pos - begin();
-  push_back(std::move(value));
-  for (size_t i = size_ - 1; i > index; --i) {
-    (*this)[i] = std::move((*this)[i - 1]);
+  return begin() + index;
+}
+
+// Opens a gap of count elements before index by growing the shorter side:
+// the elements nearest that end are move-constructed into the new slots, the
+// rest of the short side is shifted once, and source(k) fills the k-th slot of
+// the gap, either by construction or by assignment.
+template <typename T, typename Allocator, size_t BucketSize>
+template <typename Source>
+typename Deque<T, Allocator, BucketSize>::iterator
+Deque<T, Allocator, BucketSize>::insert_n(size_t index, size_t count,
+                                          Source source) {
+  if (count == 0) {
+    return begin() + index;
+  }
+  size_t old_size = size_;
+  if (index < old_size - index) {
+    size_t moved = std::min(index, count);
+    for (size_t k = count - moved; k > 0; --k) {
+      emplace_front(source(k - 1));
+    }
+    for (size_t k = 0; k < moved; ++k) {
+      emplace_front(std::move((*this)[count - 1]));
+    }
+    if (index > count) {
+      std::move(begin() + 2 * count, begin() + (index + count),
+                begin() + count);
+    }
+    size_t start = std::max(index, count);
+    auto it = begin() + start;
+    for (size_t k = start - index; k < count; ++k, ++it) {
+      *it = source(k);
+    }
+  } else {
+    size_t tail = old_size - index;
+    size_t moved = std::min(tail, count);
+    for (size_t k = moved; k < count; ++k) {
+      emplace_back(source(k));
+    }
+    for (size_t k = 0; k < moved; ++k) {
+      emplace_back(std::move((*this)[size_ - count]));
+    }
+    if (tail > count) {
+      std::move_backward(begin() + index, begin() + (old_size - count),
+                         begin() + old_size);
+    }
+    auto it = begin() + index;
+    for (size_t k = 0; k < moved; ++k, ++it) {
+      *it = source(k);
+    }
   }
-  (*this)[index] = std::move(value);
   return begin() + index;
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::erase(iterator pos) {
-  if (pos == end() - 1) {
-    pop_back();
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::new_bucket(int index) {
+  if (!spare_buckets_.empty()) {
+    buckets_[index] = spare_buckets_.back();
+    spare_buckets_.pop_back();
     return;
   }
-  for (auto it = pos; it != end() - 1; ++it) {
-    *it = std::move(*(it + 1));
+  buckets_[index] = alloc_traits::allocate(alloc_, kBucketSize);
+}
+
+// Emptied buckets are kept for reuse, up to max_spare_buckets_, so queue
+// traffic crossing a bucket boundary back and forth does not hit the
+// allocator.
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::delete_bucket(int index) {
+  T* bucket = buckets_[index];
+  buckets_[index] = nullptr;
+  if (bucket == nullptr) {
+    return;
+  }
+  if (spare_buckets_.size() < max_spare_buckets_) {
+    try {
+      spare_buckets_.reserve(max_spare_buckets_);
+      spare_buckets_.push_back(bucket);
+      return;
+    } catch (...) {
+    }
+  }
+  alloc_traits::deallocate(alloc_, bucket, kBucketSize);
+}
+
+// Makes room for one more bucket at the requested end. If the map is at
+// least twice as large as needed the used buckets are recentered in place,
+// otherwise the map grows geometrically; only bucket pointers are moved.
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::realloc(bool at_front) {
+  size_t used = last_bucket_ - first_bucket_ + 1;
+  size_t needed = used + 1;
+  size_t new_first;
+  if (buckets_.size() > 2 * needed) {
+    new_first = (buckets_.size() - needed) / 2 + (at_front ? 1 : 0);
+    auto first = buckets_.begin() + first_bucket_;
+    auto last = buckets_.begin() + last_bucket_ + 1;
+    if (new_first < first_bucket_) {
+      std::copy(first, last, buckets_.begin() + new_first);
+    } else {
+      std::copy_backward(first, last, buckets_.begin() + new_first + used);
+    }
+    std::fill(buckets_.begin(), buckets_.begin() + new_first, nullptr);
+    std::fill(buckets_.begin() + new_first + used, buckets_.end(), nullptr);
+  } else {
+    size_t new_size = buckets_.size() + std::max(buckets_.size(), needed) + 2;
+    std::vector<T*> new_vec(new_size, nullptr);
+    new_first = (new_size - needed) / 2 + (at_front ? 1 : 0);
+    std::copy(buckets_.begin() + first_bucket_,
+              buckets_.begin() + last_bucket_ + 1, new_vec.begin() + new_first);
+    buckets_.swap(new_vec);
   }
-  pop_back();
+  first_bucket_ = new_first;
+  last_bucket_ = new_first + used - 1;
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::new_bucket(int index) {
-  buckets_[index] = alloc_traits::allocate(alloc_, bucket_size_);
+// Appends count elements bucket by bucket after growing the map once to its
+// exact final size. fill(dest, n) constructs the next n elements at dest and
+// leaves none behind if it throws. An empty deque starts at first_index.
+template <typename T, typename Allocator, size_t BucketSize>
+template <typename Fill>
+void Deque<T, Allocator, BucketSize>::append_n(size_t count, Fill fill,
+                                               size_t first_index) {
+  if (count == 0) {
+    return;
+  }
+  size_t bucket = 0;
+  size_t index = first_index;
+  if (empty()) {
+    clear();
+    buckets_.assign((first_index + count - 1) / kBucketSize + 1, nullptr);
+  } else {
+    bucket = last_bucket_ + (last_index_ + 1) / kBucketSize;
+    index = (last_index_ + 1) % kBucketSize;
+    size_t last = bucket + (index + count - 1) / kBucketSize;
+    if (last >= buckets_.size()) {
+      buckets_.resize(last + 1, nullptr);
+    }
+  }
+  while (count > 0) {
+    size_t n = std::min(kBucketSize - index, count);
+    bool fresh = buckets_[bucket] == nullptr;
+    if (fresh) {
+      new_bucket(bucket);
+    }
+    try {
+      fill(buckets_[bucket] + index, n);
+    } catch (...) {
+      if (fresh) {
+        delete_bucket(bucket);
+      }
+      if (empty()) {
+        buckets_.clear();
+      }
+      throw;
+    }
+    if (empty()) {
+      first_bucket_ = bucket;
+      first_index_ = index;
+    }
+    last_bucket_ = bucket;
+    last_index_ = index + n - 1;
+    size_ += n;
+    count -= n;
+    ++bucket;
+    index = 0;
+  }
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::delete_bucket(int index) {
-  alloc_traits::deallocate(alloc_, buckets_[index], bucket_size_);
-  buckets_[index] = nullptr;
+template <typename T, typename Allocator, size_t BucketSize>
+template <typename... Args>
+void Deque<T, Allocator, BucketSize>::construct_bucket(T* dest, size_t count,
+                                                       const Args&... args) {
+  size_t built = 0;
+  try {
+    for (; built < count; ++built) {
+      alloc_traits::construct(alloc_, dest + built, args...);
+    }
+  } catch (...) {
+    for (size_t i = 0; i < built; ++i) {
+      alloc_traits::destroy(alloc_, dest + i);
+    }
+    throw;
+  }
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::realloc() {
-  std::vector<T*> new_vec(buckets_.size() * 3, nullptr);
-  size_t offset = buckets_.size();
-  for (int i = 0; i < static_cast<int>(buckets_.size()); ++i) {
-    new_vec[offset + i] = buckets_[i];
+template <typename T, typename Allocator, size_t BucketSize>
+template <typename InputIt>
+InputIt Deque<T, Allocator, BucketSize>::copy_bucket(InputIt src, size_t count,
+                                                     T* dest) {
+  if constexpr (std::contiguous_iterator<InputIt> &&
+                std::is_same_v<std::iter_value_t<InputIt>, T> &&
+                std::is_trivially_copyable_v<T> &&
+                std::is_same_v<Allocator, std::allocator<T>>) {
+    std::memcpy(dest, std::to_address(src), count * sizeof(T));
+    return src + count;
+  } else {
+    size_t built = 0;
+    try {
+      for (; built < count; ++built, ++src) {
+        alloc_traits::construct(alloc_, dest + built, *src);
+      }
+    } catch (...) {
+      for (size_t i = 0; i < built; ++i) {
+        alloc_traits::destroy(alloc_, dest + i);
+      }
+      throw;
+    }
+    return src;
   }
-  first_bucket_ += offset;
-  last_bucket_ += offset;
-  buckets_ = new_vec;
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::initialize_first_element() {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::initialize_first_element() {
   buckets_.resize(1);
   if (buckets_[0] == nullptr) {
     new_bucket(0);
@@ -751,8 +1117,8 @@ void Deque<T, Allocator>::initialize_first_element() {
   first_index_ = last_index_ = 0;
 }
 
-template <typename T, typename Allocator>
-void Deque<T, Allocator>::clear() {
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::clear() {
   if (empty()) {
     if (buckets_.size() == 1) {
       delete_bucket(0);
@@ -762,7 +1128,7 @@ void Deque<T, Allocator>::clear() {
   }
   for (size_t i = first_bucket_; i <= last_bucket_; ++i) {
     if (buckets_[i] != nullptr) {
-      for (size_t j = 0; j < bucket_size_; ++j) {
+      for (size_t j = 0; j < kBucketSize; ++j) {
         if ((i == first_bucket_ && j < first_index_) ||
             (i == last_bucket_ && j > last_index_)) {
           continue;
@@ -779,3 +1145,65 @@ void Deque<T, Allocator>::clear() {
   size_ = 0;
   buckets_.clear();
 }
+
+template <typename T, typename Allocator, size_t BucketSize>
+void Deque<T, Allocator, BucketSize>::free_spare_buckets() {
+  for (T* bucket : spare_buckets_) {
+    alloc_traits::deallocate(alloc_, bucket, kBucketSize);
+  }
+  spare_buckets_.clear();
+}
+
+// Algorithms over a range of Deque iterators that run the standard algorithm
+// once per bucket on raw pointers, so the inner loops can be vectorized.
+namespace segmented {
+
+template <typename DequeIt, typename Func>
+Func for_each(DequeIt first, DequeIt last, Func func) {
+  first.for_each_segment(last, [&func](auto begin, auto end) {
+    for (; begin != end; ++begin) {
+      func(*begin);
+    }
+    return true;
+  });
+  return func;
+}
+
+template <typename DequeIt, typename OutputIt>
+OutputIt copy(DequeIt first, DequeIt last, OutputIt out) {
+  first.for_each_segment(last, [&out](auto begin, auto end) {
+    out = std::copy(begin, end, out);
+    return true;
+  });
+  return out;
+}
+
+template <typename DequeIt, typename U>
+void fill(DequeIt first, DequeIt last, const U& value) {
+  first.for_each_segment(last, [&value](auto begin, auto end) {
+    std::fill(begin, end, value);
+    return true;
+  });
+}
+
+template <typename DequeIt, typename U>
+DequeIt find(DequeIt first, DequeIt last, const U& value) {
+  size_t offset = 0;
+  bool missing = first.for_each_segment(last, [&](auto begin, auto end) {
+    auto it = std::find(begin, end, value);
+    offset += it - begin;
+    return it == end;
+  });
+  return missing ? last : first + offset;
+}
+
+template <typename DequeIt, typename U>
+U accumulate(DequeIt first, DequeIt last, U init) {
+  first.for_each_segment(last, [&init](auto begin, auto end) {
+    init = std::accumulate(begin, end, std::move(init));
+    return true;
+  });
+  return init;
+}
+
+}  // namespace segmented
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "deque.hpp"
+
+// Chase–Lev work-stealing deque: the owning thread pushes and pops at the
+// bottom, any thread may steal from the top. Positions are mapped onto
+// fixed-size buckets through a circular bucket map, so growing doubles the map
+// and reuses every bucket instead of copying elements. Replaced maps are kept
+// until destruction because a thief may still be reading through one.
+template <typename T, size_t BucketSize = DequeBucketSize<T>()>
+class WorkStealingDeque {
+ public:
+  static constexpr size_t kBucketSize = BucketSize;
+
+  explicit WorkStealingDeque(size_t buckets = 2);
+  WorkStealingDeque(const WorkStealingDeque& other) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque& other) = delete;
+  ~WorkStealingDeque();
+
+  // Owner thread only.
+  void push(const T& value);
+  std::optional<T> pop();
+
+  // Any thread. Fails when the deque is empty or another thread won the race
+  // for the top element.
+  std::optional<T> steal();
+
+  // Approximate while other threads are active.
+  size_t size() const;
+  bool empty() const;
+
+ private:
+  static_assert(std::is_trivially_copyable_v<T>,
+                "a thief may read an element it then fails to claim");
+  static_assert(std::has_single_bit(BucketSize));
+
+  static constexpr int kShift = std::countr_zero(BucketSize);
+
+  using Slot = std::atomic<T>;
+
+  struct BucketMap {
+    explicit BucketMap(size_t count)
+        : mask(count - 1), buckets(new Slot*[count]) {}
+    Slot& operator[](int64_t position) const {
+      return buckets[(position >> kShift) & mask][position & (kBucketSize - 1)];
+    }
+
+    size_t mask;
+    std::unique_ptr<Slot*[]> buckets;
+  };
+
+  BucketMap* grow(int64_t top);
+
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+  alignas(64) std::atomic<BucketMap*> map_;
+  // Every map ever published, the current one last. Owner thread only.
+  std::vector<std::unique_ptr<BucketMap>> maps_;
+};
+
+template <typename T, size_t BucketSize>
+WorkStealingDeque<T, BucketSize>::WorkStealingDeque(size_t buckets) {
+  size_t count = std::bit_ceil(std::max<size_t>(buckets, 2));
+  auto map = std::make_unique<BucketMap>(count);
+  size_t built = 0;
+  try {
+    for (; built < count; ++built) {
+      map->buckets[built] = new Slot[kBucketSize];
+    }
+  } catch (...) {
+    for (size_t i = 0; i < built; ++i) {
+      delete[] map->buckets[i];
+    }
+    throw;
+  }
+  map_.store(map.get(), std::memory_order_relaxed);
+  maps_.push_back(std::move(map));
+}
+
+template <typename T, size_t BucketSize>
+WorkStealingDeque<T, BucketSize>::~WorkStealingDeque() {
+  const BucketMap& map = *maps_.back();
+  for (size_t i = 0; i <= map.mask; ++i) {
+    delete[] map.buckets[i];
+  }
+}
+
+template <typename T, size_t BucketSize>
+void WorkStealingDeque<T, BucketSize>::push(const T& value) {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  int64_t top = top_.load(std::memory_order_acquire);
+  BucketMap* map = maps_.back().get();
+  // Positions [top, bottom] must land in distinct buckets.
+  if ((bottom >> kShift) - (top >> kShift) > static_cast<int64_t>(map->mask)) {
+    map = grow(top);
+  }
+  (*map)[bottom].store(value, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  bottom_.store(bottom + 1, std::memory_order_relaxed);
+}
+
+template <typename T, size_t BucketSize>
+std::optional<T> WorkStealingDeque<T, BucketSize>::pop() {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+  BucketMap* map = map_.load(std::memory_order_relaxed);
+  bottom_.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  if (top > bottom) {
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  T value = (*map)[bottom].load(std::memory_order_relaxed);
+  if (top == bottom) {
+    // Last element: race the thieves for it through top.
+    bool won = top_.compare_exchange_strong(top, top + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    if (!won) {
+      return std::nullopt;
+    }
+  }
+  return value;
+}
+
+template <typename T, size_t BucketSize>
+std::optional<T> WorkStealingDeque<T, BucketSize>::steal() {
+  int64_t top = top_.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t bottom = bottom_.load(std::memory_order_acquire);
+  if (top >= bottom) {
+    return std::nullopt;
+  }
+  BucketMap* map = map_.load(std::memory_order_acquire);
+  T value = (*map)[top].load(std::memory_order_relaxed);
+  if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                    std::memory_order_relaxed)) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+template <typename T, size_t BucketSize>
+size_t WorkStealingDeque<T, BucketSize>::size() const {
+  int64_t bottom = bottom_.load(std::memory_order_relaxed);
+  int64_t top = top_.load(std::memory_order_relaxed);
+  return bottom > top ? bottom - top : 0;
+}
+
+template <typename T, size_t BucketSize>
+bool WorkStealingDeque<T, BucketSize>::empty() const {
+  return size() == 0;
+}
+
+// Doubles the map. The old buckets keep their positions starting from the
+// bucket holding top, so live elements stay where thieves expect them; the
+// other half of the new map gets fresh buckets.
+template <typename T, size_t BucketSize>
+typename WorkStealingDeque<T, BucketSize>::BucketMap*
+WorkStealingDeque<T, BucketSize>::grow(int64_t top) {
+  const BucketMap& old_map = *maps_.back();
+  size_t count = old_map.mask + 1;
+  maps_.reserve(maps_.size() + 1);
+  auto map = std::make_unique<BucketMap>(2 * count);
+  size_t first = top >> kShift;
+  for (size_t i = 0; i < count; ++i) {
+    map->buckets[(first + i) & map->mask] =
+        old_map.buckets[(first + i) & old_map.mask];
+  }
+  size_t built = 0;
+  try {
+    for (; built < count; ++built) {
+      map->buckets[(first + count + built) & map->mask] = new Slot[kBucketSize];
+    }
+  } catch (...) {
+    for (size_t i = 0; i < built; ++i) {
+      delete[] map->buckets[(first + count + i) & map->mask];
+    }
+    throw;
+  }
+  map_.store(map.get(), std::memory_order_release);
+  maps_.push_back(std::move(map));
+  return maps_.back().get();
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "list.hpp"
+
+// List of objects linked through their own ListHook member Hook, e.g.
+// IntrusiveList<Entry, &Entry::lru_hook>. Nothing is allocated or copied:
+// the list only relinks hooks, and an object with several hooks can sit in
+// several lists at once. The list does not own its objects, which must
+// outlive their membership.
+//
+// Because any hook may unlink itself without the list knowing, the list keeps
+// no element count and size() walks the list.
+//
+// Like offsetof, finding an object from its hook needs T to be standard
+// layout, which also rules out virtual bases.
+template <typename T, ListHook T::*Hook>
+class IntrusiveList {
+  static_assert(std::is_standard_layout_v<T>);
+
+ public:
+  using value_type = T;
+
+  IntrusiveList() { fakeNode_.prev = fakeNode_.next = &fakeNode_; }
+  IntrusiveList(const IntrusiveList& other) = delete;
+  IntrusiveList& operator=(const IntrusiveList& other) = delete;
+  IntrusiveList(IntrusiveList&& other) noexcept : IntrusiveList() {
+    swap(other);
+  }
+  IntrusiveList& operator=(IntrusiveList&& other) noexcept {
+    if (this != &other) {
+      clear();
+      swap(other);
+    }
+    return *this;
+  }
+  ~IntrusiveList() { clear(); }
+
+  void swap(IntrusiveList& other) noexcept {
+    bool was_empty = empty();
+    bool other_was_empty = other.empty();
+    std::swap(fakeNode_.next, other.fakeNode_.next);
+    std::swap(fakeNode_.prev, other.fakeNode_.prev);
+    adopt_chain(other_was_empty);
+    other.adopt_chain(was_empty);
+  }
+
+  T& front() { return owner(fakeNode_.next); }
+  const T& front() const { return owner(fakeNode_.next); }
+  T& back() { return owner(fakeNode_.prev); }
+  const T& back() const { return owner(fakeNode_.prev); }
+
+  bool empty() const { return fakeNode_.next == &fakeNode_; }
+  size_t size() const { return std::distance(begin(), end()); }
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using value_type = T;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+    Iterator() = default;
+    explicit Iterator(ListHook* node) : node_(node) {}
+    template <bool OtherConst>
+      requires(IsConst && !OtherConst)
+    Iterator(const Iterator<OtherConst>& other) : node_(other.node_) {}
+
+    reference operator*() const { return owner(node_); }
+    pointer operator->() const { return &owner(node_); }
+
+    Iterator& operator++() {
+      node_ = node_->next;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+    Iterator& operator--() {
+      node_ = node_->prev;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    friend class IntrusiveList;
+    template <bool>
+    friend class Iterator;
+
+    ListHook* node_ = nullptr;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+
+  iterator begin() { return iterator(fakeNode_.next); }
+  iterator end() { return iterator(&fakeNode_); }
+  const_iterator begin() const { return const_iterator(fakeNode_.next); }
+  const_iterator end() const { return const_iterator(fake_node()); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+
+  // The iterator to an object linked into this list, in O(1).
+  static iterator iterator_to(T& value) { return iterator(&(value.*Hook)); }
+
+  // value must not be linked through Hook yet.
+  iterator insert(const_iterator pos, T& value) {
+    ListHook* hook = &(value.*Hook);
+    ListHook* next = pos.node_;
+    hook->prev = next->prev;
+    hook->next = next;
+    next->prev->next = hook;
+    next->prev = hook;
+    return iterator(hook);
+  }
+  void push_back(T& value) { insert(end(), value); }
+  void push_front(T& value) { insert(begin(), value); }
+
+  iterator erase(const_iterator pos) {
+    ListHook* next = pos.node_->next;
+    pos.node_->unlink();
+    return iterator(next);
+  }
+  void pop_back() { fakeNode_.prev->unlink(); }
+  void pop_front() { fakeNode_.next->unlink(); }
+
+  // Moves value, which may be linked into this or another list through Hook,
+  // in front of pos. Moving an LRU entry to the front is
+  // lru.move_to(lru.begin(), entry).
+  void move_to(const_iterator pos, T& value) {
+    ListHook* hook = &(value.*Hook);
+    if (hook == pos.node_) {
+      return;
+    }
+    if (hook->is_linked()) {
+      hook->unlink();
+    }
+    insert(pos, value);
+  }
+
+  void clear() {
+    while (!empty()) {
+      pop_back();
+    }
+  }
+
+ private:
+  // Offset of the hook within T. A member pointer cannot name the member
+  // for offsetof, so the offset is read once off an unconstructed T in local
+  // storage. It lives in a function-local static rather than a static data
+  // member because the dynamic initialisation of a class template's static
+  // members is unordered, and a static object might use the list first.
+  static std::ptrdiff_t hook_offset() {
+    static const std::ptrdiff_t offset = [] {
+      union Storage {
+        Storage() {}
+        ~Storage() {}
+        T object;
+      } storage;
+      return reinterpret_cast<unsigned char*>(&(storage.object.*Hook)) -
+             reinterpret_cast<unsigned char*>(&storage.object);
+    }();
+    return offset;
+  }
+  static T& owner(ListHook* hook) {
+    return *reinterpret_cast<T*>(reinterpret_cast<unsigned char*>(hook) -
+                                 hook_offset());
+  }
+  static const T& owner(const ListHook* hook) {
+    return owner(const_cast<ListHook*>(hook));
+  }
+  // Points the ends of the chain just swapped in back at this fake node.
+  void adopt_chain(bool empty) {
+    if (empty) {
+      fakeNode_.next = fakeNode_.prev = &fakeNode_;
+    } else {
+      fakeNode_.next->prev = &fakeNode_;
+      fakeNode_.prev->next = &fakeNode_;
+    }
+  }
+  ListHook* fake_node() const { return const_cast<ListHook*>(&fakeNode_); }
+
+  ListHook fakeNode_;
+};
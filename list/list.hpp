@@ -1,19 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
+
+// The prev/next links List nodes are built on. Embedded in an object as a
+// member, it lets IntrusiveList link the object itself. A copied hook starts
+// unlinked: links belong to the object, not to its value.
+struct ListHook {
+  ListHook() = default;
+  ListHook(const ListHook&) {}
+  ListHook& operator=(const ListHook&) { return *this; }
+
+  bool is_linked() const { return next != nullptr; }
+  // Takes the hook out of whatever list holds it in O(1), without needing
+  // that list.
+  void unlink() {
+    prev->next = next;
+    next->prev = prev;
+    prev = nullptr;
+    next = nullptr;
+  }
+
+  ListHook* prev = nullptr;
+  ListHook* next = nullptr;
+};
+
 template <typename T, typename Allocator = std::allocator<T>>
 class List {
  private:
-  struct BaseNode {
-    BaseNode* prev;
-    BaseNode* next;
-  };
+  using BaseNode = ListHook;
   struct Node : public BaseNode {
     T value;
-    Node(const T& value) : value(value), BaseNode{nullptr, nullptr} {}
-    Node() = default;
+    template <typename... Args>
+    Node(Args&&... args) : value(std::forward<Args>(args)...) {}
   };
 
  public:
@@ -25,6 +51,11 @@ class List {
     fakeNode_.next = &fakeNode_;
   }
 
+  explicit List(const Allocator& alloc) : size_(0), allocator_(alloc) {
+    fakeNode_.prev = &fakeNode_;
+    fakeNode_.next = &fakeNode_;
+  }
+
   List(size_t count, const T& value, const Allocator& alloc = Allocator())
       : size_(0), allocator_(alloc) {
     fakeNode_.prev = &fakeNode_;
@@ -64,6 +95,12 @@ class List {
       throw;
     }
   }
+  // The allocator is copied rather than moved so that other stays usable.
+  List(List&& other) noexcept : size_(0), allocator_(other.allocator_) {
+    fakeNode_.prev = &fakeNode_;
+    fakeNode_.next = &fakeNode_;
+    swap_nodes(other);
+  }
   List(std::initializer_list<T> init, const Allocator& allocator = Allocator())
       : size_(0) {
     fakeNode_.prev = &fakeNode_;
@@ -80,31 +117,52 @@ class List {
     }
   }
   void swap(List& other) noexcept {
-    std::swap(size_, other.size_);
-    std::swap(fakeNode_.next, other.fakeNode_.next);
-    std::swap(fakeNode_.prev, other.fakeNode_.prev);
-    if (size_ > 0) {
-      fakeNode_.next->prev = &fakeNode_;
-      fakeNode_.prev->next = &fakeNode_;
-    } else {
-      fakeNode_.next = &fakeNode_;
-      fakeNode_.prev = &fakeNode_;
-    }
-    if (other.size_ > 0) {
-      other.fakeNode_.next->prev = &other.fakeNode_;
-      other.fakeNode_.prev->next = &other.fakeNode_;
-    } else {
-      other.fakeNode_.next = &other.fakeNode_;
-      other.fakeNode_.prev = &other.fakeNode_;
+    swap_nodes(other);
+    if constexpr (node_alloc_traits::propagate_on_container_swap::value) {
+      std::swap(allocator_, other.allocator_);
     }
   }
   List& operator=(const List& other) {
     if (this != &other) {
-      List tmp(other);
-      if (node_alloc_traits::propagate_on_container_copy_assignment::value) {
-        allocator_ = other.allocator_;
+      // The old nodes leave with tmp together with the allocator that made
+      // them, whether or not this list adopts the allocator of other.
+      List tmp(Allocator(
+          node_alloc_traits::propagate_on_container_copy_assignment::value
+              ? other.allocator_
+              : allocator_));
+      for (const T& value : other) {
+        tmp.push_back(value);
+      }
+      swap_nodes(tmp);
+      std::swap(allocator_, tmp.allocator_);
+    }
+    return *this;
+  }
+
+  List& operator=(List&& other) noexcept(
+      node_alloc_traits::propagate_on_container_move_assignment::value ||
+      node_alloc_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (node_alloc_traits::propagate_on_container_move_assignment::
+                      value) {
+      clear();
+      swap_nodes(other);
+      allocator_ = other.allocator_;
+    } else {
+      if (allocator_ == other.allocator_) {
+        clear();
+        swap_nodes(other);
+        return *this;
       }
-      swap(tmp);
+      // Nodes cannot change hands between unequal allocators, so the values
+      // are moved one by one into nodes of this list's allocator.
+      List tmp(get_allocator());
+      for (T& value : other) {
+        tmp.emplace_back(std::move(value));
+      }
+      swap_nodes(tmp);
     }
     return *this;
   }
@@ -119,44 +177,19 @@ class List {
 
   bool empty() const { return size_ == 0; }
   size_t size() const { return size_; }
-  void push_back() {
-    Node* new_node = nullptr;
-    try {
-      new_node = construct_node();
-      new_node->next = &fakeNode_;
-      new_node->prev = fakeNode_.prev;
-      fakeNode_.prev->next = new_node;
-      fakeNode_.prev = new_node;
-      size_++;
-    } catch (...) {
-      throw;
-    }
-  }
-  void push_back(const T& value) {
-    Node* new_node = nullptr;
-    try {
-      new_node = construct_node(value);
-      new_node->next = &fakeNode_;
-      new_node->prev = fakeNode_.prev;
-      fakeNode_.prev->next = new_node;
-      fakeNode_.prev = new_node;
-      size_++;
-    } catch (...) {
-      throw;
-    }
-  }
+  void push_back() { emplace_back(); }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
 
-  void push_front(const T& value) {
-    try {
-      Node* new_node = construct_node(value);
-      new_node->prev = &fakeNode_;
-      new_node->next = fakeNode_.next;
-      fakeNode_.next->prev = new_node;
-      fakeNode_.next = new_node;
-      size_++;
-    } catch (...) {
-      throw;
-    }
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    return *emplace(cend(), std::forward<Args>(args)...);
+  }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(cbegin(), std::forward<Args>(args)...);
   }
 
   void pop_back() {
@@ -190,6 +223,9 @@ class List {
 
     Iterator(BaseNode* node) : node_(node) {}
     Iterator(const BaseNode* node) : node_(const_cast<BaseNode*>(node)) {}
+    template <bool OtherConst>
+      requires(IsConst && !OtherConst)
+    Iterator(const Iterator<OtherConst>& other) : node_(other.node_) {}
     reference operator*() const { return static_cast<Node*>(node_)->value; }
 
     pointer operator->() const { return &(static_cast<Node*>(node_)->value); }
@@ -225,6 +261,10 @@ class List {
     }
 
    private:
+    friend class List;
+    template <bool>
+    friend class Iterator;
+
     BaseNode* node_;
   };
 
@@ -247,42 +287,382 @@ class List {
 
   allocator_type get_allocator() const noexcept { return allocator_; }
 
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    Node* node = construct_node(std::forward<Args>(args)...);
+    BaseNode* next = pos.node_;
+    node->prev = next->prev;
+    node->next = next;
+    next->prev->next = node;
+    next->prev = node;
+    ++size_;
+    return iterator(node);
+  }
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  // Multi-element inserts build the new nodes aside and splice them in, so
+  // the list is unchanged if constructing any element throws.
+  iterator insert(const_iterator pos, size_t count, const T& value) {
+    List tmp(get_allocator());
+    for (size_t i = 0; i < count; ++i) {
+      tmp.emplace_back(value);
+    }
+    return insert_nodes(pos, tmp);
+  }
+  template <std::input_iterator InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    List tmp(get_allocator());
+    for (; first != last; ++first) {
+      tmp.emplace_back(*first);
+    }
+    return insert_nodes(pos, tmp);
+  }
+
+  iterator erase(const_iterator pos) {
+    BaseNode* node = pos.node_;
+    BaseNode* next = node->next;
+    node->prev->next = next;
+    next->prev = node->prev;
+    delete_node(static_cast<Node*>(node));
+    --size_;
+    return iterator(next);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return iterator(last.node_);
+  }
+
+  // The operations below only relink nodes: no value is copied, moved or
+  // reallocated and iterators stay valid. Lists exchanging nodes must have
+  // equal allocators, since each node goes back to the allocator of the list
+  // it ends up in.
+  void splice(const_iterator pos, List& other) {
+    assert(allocator_ == other.allocator_);
+    if (&other == this || other.empty()) {
+      return;
+    }
+    transfer(pos.node_, other.fakeNode_.next, &other.fakeNode_);
+    size_ += other.size_;
+    other.size_ = 0;
+  }
+  void splice(const_iterator pos, List&& other) { splice(pos, other); }
+  void splice(const_iterator pos, List& other, const_iterator it) {
+    assert(allocator_ == other.allocator_);
+    transfer(pos.node_, it.node_, it.node_->next);
+    if (&other != this) {
+      ++size_;
+      --other.size_;
+    }
+  }
+  void splice(const_iterator pos, List&& other, const_iterator it) {
+    splice(pos, other, it);
+  }
+  void splice(const_iterator pos, List& other, const_iterator first,
+              const_iterator last) {
+    assert(allocator_ == other.allocator_);
+    if (&other != this) {
+      size_t count = std::distance(first, last);
+      size_ += count;
+      other.size_ -= count;
+    }
+    transfer(pos.node_, first.node_, last.node_);
+  }
+  void splice(const_iterator pos, List&& other, const_iterator first,
+              const_iterator last) {
+    splice(pos, other, first, last);
+  }
+
+  // Both lists must be sorted; equal elements of this list stay in front.
+  void merge(List& other) { merge(other, std::less<>()); }
+  void merge(List&& other) { merge(other, std::less<>()); }
+  template <typename Compare>
+  void merge(List& other, Compare comp) {
+    if (&other == this) {
+      return;
+    }
+    assert(allocator_ == other.allocator_);
+    size_t moved = 0;
+    try {
+      BaseNode* node = fakeNode_.next;
+      BaseNode* incoming = other.fakeNode_.next;
+      while (node != &fakeNode_ && incoming != &other.fakeNode_) {
+        if (comp(value_of(incoming), value_of(node))) {
+          BaseNode* next = incoming->next;
+          transfer(node, incoming, next);
+          incoming = next;
+          ++moved;
+        } else {
+          node = node->next;
+        }
+      }
+    } catch (...) {
+      size_ += moved;
+      other.size_ -= moved;
+      throw;
+    }
+    transfer(&fakeNode_, other.fakeNode_.next, &other.fakeNode_);
+    size_ += other.size_;
+    other.size_ = 0;
+  }
+  template <typename Compare>
+  void merge(List&& other, Compare comp) {
+    merge(other, comp);
+  }
+
+  // Stable bottom-up merge sort on the node chain: bins[i] holds a sorted run
+  // of 2^i nodes, so no memory is allocated. If comp throws, every node stays
+  // in the list in unspecified order.
+  void sort() { sort(std::less<>()); }
+  template <typename Compare>
+  void sort(Compare comp) {
+    if (size_ < 2) {
+      return;
+    }
+    BaseNode* bins[64] = {};
+    BaseNode* rest = fakeNode_.next;
+    fakeNode_.prev->next = nullptr;
+    try {
+      while (rest != nullptr) {
+        BaseNode* run = rest;
+        rest = rest->next;
+        run->next = nullptr;
+        size_t i = 0;
+        for (; bins[i] != nullptr; ++i) {
+          merge_runs(bins[i], run, comp);
+          run = std::exchange(bins[i], nullptr);
+        }
+        bins[i] = run;
+      }
+      BaseNode* run = nullptr;
+      for (BaseNode*& bin : bins) {
+        if (bin != nullptr) {
+          merge_runs(bin, run, comp);
+          run = std::exchange(bin, nullptr);
+        }
+      }
+      bins[0] = run;
+    } catch (...) {
+      relink(bins, rest);
+      throw;
+    }
+    relink(bins, nullptr);
+  }
+
+  void reverse() noexcept {
+    BaseNode* node = &fakeNode_;
+    do {
+      std::swap(node->prev, node->next);
+      node = node->prev;
+    } while (node != &fakeNode_);
+  }
+
+  // Removes all but the first of each run of equal consecutive elements and
+  // returns how many were removed.
+  size_t unique() { return unique(std::equal_to<>()); }
+  template <typename BinaryPredicate>
+  size_t unique(BinaryPredicate pred) {
+    size_t removed = 0;
+    if (size_ == 0) {
+      return removed;
+    }
+    BaseNode* kept = fakeNode_.next;
+    while (kept->next != &fakeNode_) {
+      BaseNode* node = kept->next;
+      if (pred(value_of(kept), value_of(node))) {
+        kept->next = node->next;
+        node->next->prev = kept;
+        delete_node(static_cast<Node*>(node));
+        --size_;
+        ++removed;
+      } else {
+        kept = node;
+      }
+    }
+    return removed;
+  }
+
+  // Reallocates every node and moves the values across in iteration order,
+  // so that a traversal walks memory forwards instead of jumping around a
+  // fragmented heap. All new nodes are allocated before any old one is freed,
+  // which lets a sequential allocator (a fresh pool chunk, the top of the
+  // malloc heap) hand out adjacent blocks, and they are used in address order
+  // whatever order the allocator returned them in. Needs room for a second
+  // copy of the nodes while it runs. Invalidates iterators; if an allocation
+  // or a copy throws, the list is unchanged.
+  void compact() {
+    if (size_ < 2) {
+      return;
+    }
+    node_ptr_alloc ptr_alloc(allocator_);
+    Node** nodes = node_ptr_alloc_traits::allocate(ptr_alloc, size_);
+    size_t allocated = 0;
+    size_t built = 0;
+    try {
+      for (; allocated < size_; ++allocated) {
+        nodes[allocated] = node_alloc_traits::allocate(allocator_, 1);
+      }
+      std::sort(nodes, nodes + size_, std::less<Node*>());
+      for (BaseNode* node = fakeNode_.next; node != &fakeNode_;
+           node = node->next, ++built) {
+        node_alloc_traits::construct(allocator_, nodes[built],
+                                     std::move_if_noexcept(value_of(node)));
+      }
+    } catch (...) {
+      for (size_t i = 0; i < allocated; ++i) {
+        if (i < built) {
+          node_alloc_traits::destroy(allocator_, nodes[i]);
+        }
+        node_alloc_traits::deallocate(allocator_, nodes[i], 1);
+      }
+      node_ptr_alloc_traits::deallocate(ptr_alloc, nodes, size_);
+      throw;
+    }
+    for (BaseNode* node = fakeNode_.next; node != &fakeNode_;) {
+      BaseNode* next = node->next;
+      delete_node(static_cast<Node*>(node));
+      node = next;
+    }
+    BaseNode* prev = &fakeNode_;
+    for (size_t i = 0; i < size_; ++i) {
+      prev->next = nodes[i];
+      nodes[i]->prev = prev;
+      prev = nodes[i];
+    }
+    prev->next = &fakeNode_;
+    fakeNode_.prev = prev;
+    node_ptr_alloc_traits::deallocate(ptr_alloc, nodes, size_);
+  }
+
  private:
   using alloc_traits = std::allocator_traits<Allocator>;
   using node_alloc = typename alloc_traits::template rebind_alloc<Node>;
   using node_alloc_traits = typename alloc_traits::template rebind_traits<Node>;
+  using node_ptr_alloc = typename alloc_traits::template rebind_alloc<Node*>;
+  using node_ptr_alloc_traits =
+      typename alloc_traits::template rebind_traits<Node*>;
   BaseNode fakeNode_;
   size_t size_ = 0;
   node_alloc allocator_;
 
-  Node* construct_node(const T& value) {
+  template <typename... Args>
+  Node* construct_node(Args&&... args) {
     Node* node = node_alloc_traits::allocate(allocator_, 1);
     try {
-      node_alloc_traits::construct(allocator_, node, value);
+      node_alloc_traits::construct(allocator_, node,
+                                   std::forward<Args>(args)...);
     } catch (...) {
       node_alloc_traits::deallocate(allocator_, node, 1);
       throw;
     }
-    node->next = nullptr;
-    node->prev = nullptr;
     return node;
   }
-  Node* construct_node() {
-    Node* node = node_alloc_traits::allocate(allocator_, 1);
+  void delete_node(Node* node) {
+    if (node) {
+      node_alloc_traits::destroy(allocator_, node);
+      node_alloc_traits::deallocate(allocator_, node, 1);
+    }
+  }
+
+  iterator insert_nodes(const_iterator pos, List& nodes) {
+    if (nodes.empty()) {
+      return iterator(pos.node_);
+    }
+    iterator first(nodes.fakeNode_.next);
+    splice(pos, nodes);
+    return first;
+  }
+
+  static T& value_of(BaseNode* node) { return static_cast<Node*>(node)->value; }
+
+  // Moves the nodes [first, last) in front of pos; the range and pos may
+  // belong to different lists.
+  static void transfer(BaseNode* pos, BaseNode* first, BaseNode* last) {
+    if (first == last || pos == first || pos == last) {
+      return;
+    }
+    BaseNode* tail = last->prev;
+    first->prev->next = last;
+    last->prev = first->prev;
+    first->prev = pos->prev;
+    tail->next = pos;
+    pos->prev->next = first;
+    pos->prev = tail;
+  }
+
+  // Merges two null-terminated next chains into into; elements of into win
+  // ties. If comp throws, into still receives every node of both chains.
+  template <typename Compare>
+  static void merge_runs(BaseNode*& into, BaseNode* other, Compare& comp) {
+    BaseNode head;
+    BaseNode* tail = &head;
+    BaseNode* first = into;
+    BaseNode* second = other;
     try {
-      node_alloc_traits::construct(allocator_, node);
+      while (first != nullptr && second != nullptr) {
+        if (comp(value_of(second), value_of(first))) {
+          tail->next = second;
+          second = second->next;
+        } else {
+          tail->next = first;
+          first = first->next;
+        }
+        tail = tail->next;
+      }
     } catch (...) {
-      node_alloc_traits::deallocate(allocator_, node, 1);
+      tail->next = first;
+      while (tail->next != nullptr) {
+        tail = tail->next;
+      }
+      tail->next = second;
+      into = head.next;
       throw;
     }
-    node->next = nullptr;
-    node->prev = nullptr;
-    return node;
+    tail->next = first != nullptr ? first : second;
+    into = head.next;
   }
-  void delete_node(Node* node) {
-    if (node) {
-      node_alloc_traits::destroy(allocator_, node);
-      node_alloc_traits::deallocate(allocator_, node, 1);
+
+  // Rebuilds the list from null-terminated next chains.
+  template <size_t Count>
+  void relink(BaseNode* (&chains)[Count], BaseNode* rest) {
+    BaseNode* prev = &fakeNode_;
+    auto append = [&prev](BaseNode* node) {
+      for (; node != nullptr; node = node->next) {
+        prev->next = node;
+        node->prev = prev;
+        prev = node;
+      }
+    };
+    for (BaseNode* chain : chains) {
+      append(chain);
+    }
+    append(rest);
+    prev->next = &fakeNode_;
+    fakeNode_.prev = prev;
+  }
+
+  void swap_nodes(List& other) noexcept {
+    std::swap(size_, other.size_);
+    std::swap(fakeNode_.next, other.fakeNode_.next);
+    std::swap(fakeNode_.prev, other.fakeNode_.prev);
+    if (size_ > 0) {
+      fakeNode_.next->prev = &fakeNode_;
+      fakeNode_.prev->next = &fakeNode_;
+    } else {
+      fakeNode_.next = &fakeNode_;
+      fakeNode_.prev = &fakeNode_;
+    }
+    if (other.size_ > 0) {
+      other.fakeNode_.next->prev = &other.fakeNode_;
+      other.fakeNode_.prev->next = &other.fakeNode_;
+    } else {
+      other.fakeNode_.next = &other.fakeNode_;
+      other.fakeNode_.prev = &other.fakeNode_;
     }
   }
 
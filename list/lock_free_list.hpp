@@ -0,0 +1,355 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Harris–Michael lock-free ordered set: any number of threads may insert,
+// erase, look up and traverse concurrently. Like List it hangs value nodes
+// off a value-less head node, but links are single atomic next words whose
+// low bit marks the node owning them as logically deleted. Erasing marks the
+// node first and unlinks it second, and every traversal helps unlink marked
+// nodes it passes.
+//
+// Unlinked nodes are reclaimed by epochs: every operation pins the current
+// global epoch, and a node retired in epoch e is freed once the epoch reaches
+// e + 2, by which time no operation that could have seen it is still running.
+template <typename T, typename Compare = std::less<T>>
+class LockFreeList {
+ private:
+  struct BaseNode {
+    std::atomic<uintptr_t> next{0};
+  };
+  struct Node : public BaseNode {
+    template <typename... Args>
+    explicit Node(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+    T value;
+  };
+
+ public:
+  using value_type = T;
+
+  LockFreeList() = default;
+  explicit LockFreeList(const Compare& comp) : comp_(comp) {}
+  LockFreeList(const LockFreeList& other) = delete;
+  LockFreeList& operator=(const LockFreeList& other) = delete;
+  ~LockFreeList();
+
+  // Returns false if an equal element is already present.
+  bool insert(const T& value) { return emplace(value); }
+  bool insert(T&& value) { return emplace(std::move(value)); }
+  template <typename... Args>
+  bool emplace(Args&&... args);
+  // Returns false if no equal element was present.
+  bool erase(const T& value);
+  bool contains(const T& value) const;
+
+  // Calls func on every element in order. Elements inserted or erased while
+  // the traversal runs may or may not be visited.
+  template <typename Func>
+  void for_each(Func func) const;
+
+  // Approximate while other threads are active. A node is counted out when
+  // it is marked, which can happen before its inserter counts it in, so the
+  // counter may dip below zero for a moment; it reads as 0 then.
+  size_t size() const {
+    std::ptrdiff_t size = size_.load(std::memory_order_relaxed);
+    return size < 0 ? 0 : static_cast<size_t>(size);
+  }
+  bool empty() const { return size() == 0; }
+
+ private:
+  static constexpr uintptr_t kMark = 1;
+  static constexpr size_t kReclaimThreshold = 64;
+
+  static Node* node_of(uintptr_t link) {
+    return reinterpret_cast<Node*>(link & ~kMark);
+  }
+  static uintptr_t link_of(Node* node) {
+    return reinterpret_cast<uintptr_t>(node);
+  }
+  static bool marked(uintptr_t link) { return (link & kMark) != 0; }
+
+  // Per-thread reclamation state. Records are claimed for the length of one
+  // operation and only freed with the list, so at most one record per
+  // concurrently running operation is ever created. A record reclaims once it
+  // holds kReclaimThreshold retired nodes, and then also sweeps the records
+  // nobody holds, so nodes left on a record that is never claimed again are
+  // freed by the next reclaim of any thread or, failing that, with the list.
+  struct Participant {
+    // Zero when idle, otherwise one more than the pinned epoch.
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> claimed{true};
+    Participant* next = nullptr;
+    // (epoch of retirement, node). Touched only by the claiming thread.
+    std::vector<std::pair<uint64_t, Node*>> retired;
+  };
+
+  class Guard {
+   public:
+    explicit Guard(const LockFreeList& list);
+    Guard(const Guard& other) = delete;
+    Guard& operator=(const Guard& other) = delete;
+    ~Guard();
+
+    void retire(Node* node);
+
+   private:
+    void reclaim();
+    // Frees the nodes retired at least two epochs before epoch.
+    static void free_expired(std::vector<std::pair<uint64_t, Node*>>& retired,
+                             uint64_t epoch);
+
+    const LockFreeList& list_;
+    Participant* participant_;
+  };
+
+  struct Position {
+    BaseNode* prev;
+    Node* curr;
+    bool found;
+  };
+  // Finds the first node not less than value and its predecessor, unlinking
+  // the marked nodes on the way.
+  Position find(const T& value, Guard& guard) const;
+
+  Participant* claim_participant() const;
+  bool try_advance_epoch() const;
+
+  mutable BaseNode head_;
+  std::atomic<std::ptrdiff_t> size_{0};
+  mutable std::atomic<uint64_t> epoch_{1};
+  mutable std::atomic<Participant*> participants_{nullptr};
+  Compare comp_;
+};
+
+template <typename T, typename Compare>
+LockFreeList<T, Compare>::~LockFreeList() {
+  Node* node = node_of(head_.next.load(std::memory_order_relaxed));
+  while (node != nullptr) {
+    Node* next = node_of(node->next.load(std::memory_order_relaxed));
+    delete node;
+    node = next;
+  }
+  Participant* participant = participants_.load(std::memory_order_relaxed);
+  while (participant != nullptr) {
+    for (auto& [epoch, retired] : participant->retired) {
+      delete retired;
+    }
+    delete std::exchange(participant, participant->next);
+  }
+}
+
+template <typename T, typename Compare>
+template <typename... Args>
+bool LockFreeList<T, Compare>::emplace(Args&&... args) {
+  // Owned here until linked, since the comparator or retiring a node inside
+  // find may throw.
+  auto node = std::make_unique<Node>(std::forward<Args>(args)...);
+  Guard guard(*this);
+  while (true) {
+    Position pos = find(node->value, guard);
+    if (pos.found) {
+      return false;
+    }
+    uintptr_t expected = link_of(pos.curr);
+    node->next.store(expected, std::memory_order_relaxed);
+    if (pos.prev->next.compare_exchange_weak(expected, link_of(node.get()),
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+      node.release();
+      size_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+}
+
+template <typename T, typename Compare>
+bool LockFreeList<T, Compare>::erase(const T& value) {
+  Guard guard(*this);
+  while (true) {
+    Position pos = find(value, guard);
+    if (!pos.found) {
+      return false;
+    }
+    uintptr_t next = pos.curr->next.load(std::memory_order_acquire);
+    if (marked(next)) {
+      continue;
+    }
+    // Marking is the linearisation point: whoever marks the node erased it.
+    if (!pos.curr->next.compare_exchange_weak(next, next | kMark,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+      continue;
+    }
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    uintptr_t expected = link_of(pos.curr);
+    if (pos.prev->next.compare_exchange_strong(expected, next,
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_relaxed)) {
+      guard.retire(pos.curr);
+    } else {
+      find(value, guard);
+    }
+    return true;
+  }
+}
+
+template <typename T, typename Compare>
+bool LockFreeList<T, Compare>::contains(const T& value) const {
+  Guard guard(*this);
+  Node* node = node_of(head_.next.load(std::memory_order_acquire));
+  while (node != nullptr && comp_(node->value, value)) {
+    node = node_of(node->next.load(std::memory_order_acquire));
+  }
+  return node != nullptr && !comp_(value, node->value) &&
+         !marked(node->next.load(std::memory_order_acquire));
+}
+
+template <typename T, typename Compare>
+template <typename Func>
+void LockFreeList<T, Compare>::for_each(Func func) const {
+  Guard guard(*this);
+  Node* node = node_of(head_.next.load(std::memory_order_acquire));
+  while (node != nullptr) {
+    uintptr_t next = node->next.load(std::memory_order_acquire);
+    if (!marked(next)) {
+      func(node->value);
+    }
+    node = node_of(next);
+  }
+}
+
+template <typename T, typename Compare>
+typename LockFreeList<T, Compare>::Position LockFreeList<T, Compare>::find(
+    const T& value, Guard& guard) const {
+  while (true) {
+    BaseNode* prev = &head_;
+    uintptr_t curr = prev->next.load(std::memory_order_acquire);
+    while (true) {
+      Node* node = node_of(curr);
+      if (node == nullptr) {
+        return {prev, nullptr, false};
+      }
+      uintptr_t next = node->next.load(std::memory_order_acquire);
+      if (marked(next)) {
+        // prev->next still holding an unmarked link to node means prev is
+        // live, so unlinking node here cannot lose a concurrent insertion.
+        // Otherwise prev changed under us and the walk restarts.
+        uintptr_t expected = curr;
+        if (!prev->next.compare_exchange_strong(expected, next & ~kMark,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+          break;
+        }
+        guard.retire(node);
+        curr = next & ~kMark;
+        continue;
+      }
+      if (!comp_(node->value, value)) {
+        return {prev, node, !comp_(value, node->value)};
+      }
+      prev = node;
+      curr = next;
+    }
+  }
+}
+
+template <typename T, typename Compare>
+typename LockFreeList<T, Compare>::Participant*
+LockFreeList<T, Compare>::claim_participant() const {
+  for (Participant* participant =
+           participants_.load(std::memory_order_acquire);
+       participant != nullptr; participant = participant->next) {
+    if (!participant->claimed.load(std::memory_order_relaxed) &&
+        !participant->claimed.exchange(true, std::memory_order_acquire)) {
+      return participant;
+    }
+  }
+  auto* participant = new Participant;
+  Participant* head = participants_.load(std::memory_order_relaxed);
+  do {
+    participant->next = head;
+  } while (!participants_.compare_exchange_weak(head, participant,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+  return participant;
+}
+
+// The epoch may move on only once every pinned operation has seen the
+// current one.
+template <typename T, typename Compare>
+bool LockFreeList<T, Compare>::try_advance_epoch() const {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+  for (Participant* participant =
+           participants_.load(std::memory_order_acquire);
+       participant != nullptr; participant = participant->next) {
+    uint64_t pinned = participant->epoch.load(std::memory_order_seq_cst);
+    if (pinned != 0 && pinned != epoch + 1) {
+      return false;
+    }
+  }
+  return epoch_.compare_exchange_strong(epoch, epoch + 1,
+                                        std::memory_order_seq_cst);
+}
+
+template <typename T, typename Compare>
+LockFreeList<T, Compare>::Guard::Guard(const LockFreeList& list)
+    : list_(list), participant_(list.claim_participant()) {
+  // A stale epoch only holds reclamation back, so one load is enough; the
+  // fence orders the announcement before every read of the list.
+  participant_->epoch.store(list_.epoch_.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template <typename T, typename Compare>
+LockFreeList<T, Compare>::Guard::~Guard() {
+  participant_->epoch.store(0, std::memory_order_release);
+  if (participant_->retired.size() >= kReclaimThreshold) {
+    reclaim();
+  }
+  participant_->claimed.store(false, std::memory_order_release);
+}
+
+template <typename T, typename Compare>
+void LockFreeList<T, Compare>::Guard::retire(Node* node) {
+  participant_->retired.emplace_back(
+      list_.epoch_.load(std::memory_order_seq_cst), node);
+}
+
+template <typename T, typename Compare>
+void LockFreeList<T, Compare>::Guard::reclaim() {
+  list_.try_advance_epoch();
+  uint64_t epoch = list_.epoch_.load(std::memory_order_acquire);
+  free_expired(participant_->retired, epoch);
+  for (Participant* participant =
+           list_.participants_.load(std::memory_order_acquire);
+       participant != nullptr; participant = participant->next) {
+    if (!participant->claimed.load(std::memory_order_relaxed) &&
+        !participant->claimed.exchange(true, std::memory_order_acquire)) {
+      free_expired(participant->retired, epoch);
+      participant->claimed.store(false, std::memory_order_release);
+    }
+  }
+}
+
+template <typename T, typename Compare>
+void LockFreeList<T, Compare>::Guard::free_expired(
+    std::vector<std::pair<uint64_t, Node*>>& retired, uint64_t epoch) {
+  size_t kept = 0;
+  for (auto& entry : retired) {
+    if (entry.first + 2 <= epoch) {
+      delete entry.second;
+    } else {
+      retired[kept++] = entry;
+    }
+  }
+  retired.resize(kept);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Size-class pool behind PoolAllocator. Small blocks are carved out of chunks
+// that double in size and recycled through per-class free lists; memory goes
+// back to the system only when the pool dies. Not thread-safe.
+class NodePool {
+ public:
+  NodePool() = default;
+  NodePool(const NodePool& other) = delete;
+  NodePool& operator=(const NodePool& other) = delete;
+  ~NodePool();
+
+  void* allocate(size_t bytes, size_t alignment);
+  void deallocate(void* ptr, size_t bytes, size_t alignment);
+  size_t chunk_count() const { return chunks_.size(); }
+
+  // The pool of default-constructed PoolAllocators of every type on the
+  // calling thread.
+  static const std::shared_ptr<NodePool>& thread_default();
+
+ private:
+  static constexpr size_t kGranularity = alignof(std::max_align_t);
+  static constexpr size_t kClasses = 16;
+  static constexpr size_t kFirstChunkBlocks = 32;
+  static constexpr size_t kMaxChunkBlocks = 4096;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+  struct SizeClass {
+    FreeBlock* free = nullptr;
+    size_t chunk_blocks = kFirstChunkBlocks;
+  };
+
+  static bool pooled(size_t bytes, size_t alignment) {
+    return bytes <= kClasses * kGranularity && alignment <= kGranularity;
+  }
+  static size_t class_index(size_t bytes) {
+    return bytes == 0 ? 0 : (bytes - 1) / kGranularity;
+  }
+  void refill(size_t index);
+
+  SizeClass classes_[kClasses];
+  std::vector<void*> chunks_;
+};
+
+inline NodePool::~NodePool() {
+  for (void* chunk : chunks_) {
+    ::operator delete(chunk);
+  }
+}
+
+inline const std::shared_ptr<NodePool>& NodePool::thread_default() {
+  thread_local const std::shared_ptr<NodePool> pool =
+      std::make_shared<NodePool>();
+  return pool;
+}
+
+inline void* NodePool::allocate(size_t bytes, size_t alignment) {
+  if (!pooled(bytes, alignment)) {
+    return ::operator new(bytes, std::align_val_t(alignment));
+  }
+  SizeClass& size_class = classes_[class_index(bytes)];
+  if (size_class.free == nullptr) {
+    refill(class_index(bytes));
+  }
+  FreeBlock* block = size_class.free;
+  size_class.free = block->next;
+  return block;
+}
+
+inline void NodePool::deallocate(void* ptr, size_t bytes, size_t alignment) {
+  if (!pooled(bytes, alignment)) {
+    ::operator delete(ptr, std::align_val_t(alignment));
+    return;
+  }
+  SizeClass& size_class = classes_[class_index(bytes)];
+  size_class.free = new (ptr) FreeBlock{size_class.free};
+}
+
+inline void NodePool::refill(size_t index) {
+  SizeClass& size_class = classes_[index];
+  size_t block_size = (index + 1) * kGranularity;
+  size_t blocks = size_class.chunk_blocks;
+  chunks_.reserve(chunks_.size() + 1);
+  char* chunk = static_cast<char*>(::operator new(block_size * blocks));
+  chunks_.push_back(chunk);
+  for (size_t i = blocks; i > 0; --i) {
+    size_class.free =
+        new (chunk + (i - 1) * block_size) FreeBlock{size_class.free};
+  }
+  size_class.chunk_blocks = std::min(2 * blocks, kMaxChunkBlocks);
+}
+
+// Drop-in allocator drawing from a NodePool. Copies and rebinds share the
+// pool, so List's rebound node allocator and the allocator it was built from
+// compare equal; the pool lives as long as any allocator using it.
+//
+// Default-constructed allocators of every type share a default pool, much
+// like the pmr default resource, so two default pooled Lists compare equal
+// and may splice, merge and move-assign nodes between them. NodePool takes
+// no locks, so that default pool is per thread: lists default-constructed on
+// different threads get different pools and must not exchange nodes. Pass a
+// pool of its own to keep a list's nodes apart.
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  PoolAllocator() : pool_(NodePool::thread_default()) {}
+  explicit PoolAllocator(std::shared_ptr<NodePool> pool) noexcept
+      : pool_(std::move(pool)) {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other) noexcept : pool_(other.pool_) {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(pool_->allocate(count * sizeof(T), alignof(T)));
+  }
+  void deallocate(T* ptr, size_t count) {
+    pool_->deallocate(ptr, count * sizeof(T), alignof(T));
+  }
+
+  const NodePool& pool() const { return *pool_; }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return pool_ == other.pool_;
+  }
+
+ private:
+  template <typename U>
+  friend class PoolAllocator;
+
+  std::shared_ptr<NodePool> pool_;
+};
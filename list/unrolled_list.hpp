@@ -0,0 +1,513 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+const size_t kUnrolledNodeBytes = 256;
+const size_t kUnrolledMinNodeCapacity = 4;
+
+// Elements per node: as many as fit in kUnrolledNodeBytes, but never fewer
+// than kUnrolledMinNodeCapacity.
+template <typename T>
+constexpr size_t UnrolledNodeCapacity() {
+  return std::max(kUnrolledMinNodeCapacity, kUnrolledNodeBytes / sizeof(T));
+}
+
+// List whose nodes each hold up to NodeCapacity elements in place, so a
+// traversal touches one node per NodeCapacity elements instead of one per
+// element. Every node but the fake one is non-empty. Full nodes are split in
+// half on insertion and sparse neighbours are merged on erasure, so insertion
+// and erasure near an iterator cost O(NodeCapacity). Unlike List, both
+// invalidate iterators into the nodes they touch.
+template <typename T, typename Allocator = std::allocator<T>,
+          size_t NodeCapacity = UnrolledNodeCapacity<T>()>
+class UnrolledList {
+ private:
+  static_assert(NodeCapacity >= 2);
+
+  struct BaseNode {
+    BaseNode* prev;
+    BaseNode* next;
+    size_t count;
+  };
+  struct Node : public BaseNode {
+    Node() : BaseNode{nullptr, nullptr, 0} {}
+    T* values() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+    alignas(T) unsigned char storage[NodeCapacity * sizeof(T)];
+  };
+
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  static constexpr size_t kNodeCapacity = NodeCapacity;
+
+  UnrolledList() : allocator_(node_alloc()) {}
+  explicit UnrolledList(const Allocator& alloc) : allocator_(alloc) {}
+  UnrolledList(size_t count, const T& value,
+               const Allocator& alloc = Allocator())
+      : allocator_(alloc) {
+    try {
+      for (size_t i = 0; i < count; ++i) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  UnrolledList(std::initializer_list<T> init,
+               const Allocator& alloc = Allocator())
+      : allocator_(alloc) {
+    try {
+      for (const T& value : init) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  UnrolledList(const UnrolledList& other)
+      : allocator_(node_alloc_traits::select_on_container_copy_construction(
+            other.allocator_)) {
+    try {
+      for (const T& value : other) {
+        push_back(value);
+      }
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+  UnrolledList(UnrolledList&& other) noexcept : allocator_(other.allocator_) {
+    swap_nodes(other);
+  }
+
+  UnrolledList& operator=(const UnrolledList& other) {
+    if (this != &other) {
+      UnrolledList tmp(Allocator(
+          node_alloc_traits::propagate_on_container_copy_assignment::value
+              ? other.allocator_
+              : allocator_));
+      for (const T& value : other) {
+        tmp.push_back(value);
+      }
+      swap_nodes(tmp);
+      std::swap(allocator_, tmp.allocator_);
+    }
+    return *this;
+  }
+  UnrolledList& operator=(UnrolledList&& other) noexcept(
+      node_alloc_traits::propagate_on_container_move_assignment::value ||
+      node_alloc_traits::is_always_equal::value) {
+    if (this == &other) {
+      return *this;
+    }
+    if constexpr (node_alloc_traits::propagate_on_container_move_assignment::
+                      value) {
+      clear();
+      swap_nodes(other);
+      allocator_ = other.allocator_;
+    } else {
+      if (allocator_ == other.allocator_) {
+        clear();
+        swap_nodes(other);
+        return *this;
+      }
+      UnrolledList tmp(get_allocator());
+      for (T& value : other) {
+        tmp.push_back(std::move(value));
+      }
+      swap_nodes(tmp);
+    }
+    return *this;
+  }
+
+  ~UnrolledList() { clear(); }
+
+  void swap(UnrolledList& other) noexcept {
+    swap_nodes(other);
+    if constexpr (node_alloc_traits::propagate_on_container_swap::value) {
+      std::swap(allocator_, other.allocator_);
+    }
+  }
+
+  T& front() { return node_of(fakeNode_.next)->values()[0]; }
+  const T& front() const { return node_of(fakeNode_.next)->values()[0]; }
+
+  T& back() { return last_value(fakeNode_.prev); }
+  const T& back() const { return last_value(fakeNode_.prev); }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  size_t node_count() const { return node_count_; }
+
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void push_front(const T& value) { emplace_front(value); }
+  void push_front(T&& value) { emplace_front(std::move(value)); }
+
+  // Appending fills the last node before starting a new one, so bulk
+  // push_back packs nodes completely.
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    BaseNode* last = fakeNode_.prev;
+    if (last == &fakeNode_ || last->count == kNodeCapacity) {
+      last = create_node(fakeNode_.prev);
+    }
+    Node* node = node_of(last);
+    try {
+      node_alloc_traits::construct(allocator_, node->values() + node->count,
+                                   std::forward<Args>(args)...);
+    } catch (...) {
+      if (node->count == 0) {
+        destroy_node(node);
+      }
+      throw;
+    }
+    ++node->count;
+    ++size_;
+    return node->values()[node->count - 1];
+  }
+  template <typename... Args>
+  T& emplace_front(Args&&... args) {
+    return *emplace(cbegin(), std::forward<Args>(args)...);
+  }
+
+  void pop_back() {
+    if (size_ != 0) {
+      Node* node = node_of(fakeNode_.prev);
+      node_alloc_traits::destroy(allocator_, node->values() + node->count - 1);
+      --size_;
+      if (--node->count == 0) {
+        destroy_node(node);
+      }
+    }
+  }
+  void pop_front() {
+    if (size_ != 0) {
+      erase(cbegin());
+    }
+  }
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using value_type = T;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+
+    Iterator() = default;
+    Iterator(BaseNode* node, size_t index) : node_(node), index_(index) {}
+    template <bool OtherConst>
+      requires(IsConst && !OtherConst)
+    Iterator(const Iterator<OtherConst>& other)
+        : node_(other.node_), index_(other.index_) {}
+
+    reference operator*() const { return node_of(node_)->values()[index_]; }
+    pointer operator->() const { return node_of(node_)->values() + index_; }
+
+    Iterator& operator++() {
+      if (++index_ == node_->count) {
+        node_ = node_->next;
+        index_ = 0;
+      }
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    Iterator& operator--() {
+      if (index_ == 0) {
+        node_ = node_->prev;
+        index_ = node_->count;
+      }
+      --index_;
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return node_ == other.node_ && index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class UnrolledList;
+    template <bool>
+    friend class Iterator;
+
+    BaseNode* node_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  iterator begin() { return iterator(fakeNode_.next, 0); }
+  iterator end() { return iterator(&fakeNode_, 0); }
+
+  const_iterator begin() const { return cbegin(); }
+  const_iterator end() const { return cend(); }
+  const_iterator cbegin() const { return const_iterator(fakeNode_.next, 0); }
+  const_iterator cend() const { return const_iterator(fake_node(), 0); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const { return crbegin(); }
+  const_reverse_iterator rend() const { return crend(); }
+  const_reverse_iterator crbegin() const {
+    return const_reverse_iterator(cend());
+  }
+  const_reverse_iterator crend() const {
+    return const_reverse_iterator(cbegin());
+  }
+
+  allocator_type get_allocator() const noexcept { return allocator_; }
+
+  // The value is built before anything is shifted, so args may refer to
+  // elements of this list. If building the value throws, the list is
+  // unchanged. If moving an existing element throws, the basic guarantee
+  // holds: size() still matches the elements present, but some of them may
+  // be left moved-from.
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args) {
+    BaseNode* base = pos.node_;
+    size_t index = pos.index_;
+    if (base == &fakeNode_) {
+      emplace_back(std::forward<Args>(args)...);
+      return iterator(fakeNode_.prev, fakeNode_.prev->count - 1);
+    }
+    if (index == 0 && base->prev != &fakeNode_ &&
+        base->prev->count < kNodeCapacity) {
+      // Appending to the previous node shifts nothing.
+      BaseNode* prev = base->prev;
+      construct_at_end(node_of(prev), std::forward<Args>(args)...);
+      return iterator(prev, prev->count - 1);
+    }
+    T value(std::forward<Args>(args)...);
+    if (base->count == kNodeCapacity) {
+      split(node_of(base));
+      if (index > base->count) {
+        index -= base->count;
+        base = base->next;
+      }
+    }
+    Node* node = node_of(base);
+    if (index == node->count) {
+      construct_at_end(node, std::move(value));
+      return iterator(base, index);
+    }
+    T* values = node->values();
+    size_t count = node->count;
+    construct_at_end(node, std::move(values[count - 1]));
+    std::move_backward(values + index, values + count - 1, values + count);
+    values[index] = std::move(value);
+    return iterator(base, index);
+  }
+  iterator insert(const_iterator pos, const T& value) {
+    return emplace(pos, value);
+  }
+  iterator insert(const_iterator pos, T&& value) {
+    return emplace(pos, std::move(value));
+  }
+  template <std::input_iterator InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    // Each emplace may split the node holding earlier insertions, so the
+    // first new element is found again from the last one.
+    iterator next(pos.node_, pos.index_);
+    size_t count = 0;
+    for (; first != last; ++first, ++count) {
+      next = std::next(emplace(next, *first));
+    }
+    return std::prev(next, count);
+  }
+
+  // If a move throws, pos may already be gone and some elements may be left
+  // moved-from, but size() still matches the elements present.
+  iterator erase(const_iterator pos) {
+    Node* node = node_of(pos.node_);
+    size_t index = pos.index_;
+    T* values = node->values();
+    std::move(values + index + 1, values + node->count, values + index);
+    node_alloc_traits::destroy(allocator_, values + node->count - 1);
+    --node->count;
+    --size_;
+    if (node->count == 0) {
+      BaseNode* next = node->next;
+      destroy_node(node);
+      return iterator(next, 0);
+    }
+    return rebalance(node, index);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    iterator it(first.node_, first.index_);
+    for (size_t count = std::distance(first, last); count > 0; --count) {
+      it = erase(it);
+    }
+    return it;
+  }
+
+  void clear() {
+    while (fakeNode_.prev != &fakeNode_) {
+      Node* node = node_of(fakeNode_.prev);
+      size_ -= node->count;
+      destroy_values(node);
+      destroy_node(node);
+    }
+  }
+
+ private:
+  using alloc_traits = std::allocator_traits<Allocator>;
+  using node_alloc = typename alloc_traits::template rebind_alloc<Node>;
+  using node_alloc_traits = typename alloc_traits::template rebind_traits<Node>;
+
+  BaseNode fakeNode_{&fakeNode_, &fakeNode_, 0};
+  size_t size_ = 0;
+  size_t node_count_ = 0;
+  node_alloc allocator_;
+
+  static Node* node_of(BaseNode* node) { return static_cast<Node*>(node); }
+  static const Node* node_of(const BaseNode* node) {
+    return static_cast<const Node*>(node);
+  }
+  BaseNode* fake_node() const { return const_cast<BaseNode*>(&fakeNode_); }
+  T& last_value(BaseNode* node) const {
+    return node_of(node)->values()[node->count - 1];
+  }
+
+  // Allocates an empty node and links it after prev.
+  BaseNode* create_node(BaseNode* prev) {
+    Node* node = node_alloc_traits::allocate(allocator_, 1);
+    node_alloc_traits::construct(allocator_, node);
+    node->prev = prev;
+    node->next = prev->next;
+    prev->next->prev = node;
+    prev->next = node;
+    ++node_count_;
+    return node;
+  }
+  // Unlinks and frees a node whose elements are already destroyed.
+  void destroy_node(Node* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node_alloc_traits::destroy(allocator_, node);
+    node_alloc_traits::deallocate(allocator_, node, 1);
+    --node_count_;
+  }
+
+  template <typename... Args>
+  void construct_at_end(Node* node, Args&&... args) {
+    node_alloc_traits::construct(allocator_, node->values() + node->count,
+                                 std::forward<Args>(args)...);
+    ++node->count;
+    ++size_;
+  }
+
+  // Leaves size_ alone: callers decide whether the values were counted.
+  void destroy_values(Node* node) {
+    for (size_t i = 0; i < node->count; ++i) {
+      node_alloc_traits::destroy(allocator_, node->values() + i);
+    }
+    node->count = 0;
+  }
+
+  // Moves the upper half of a full node into a new node right after it. If a
+  // move throws, the new node is dropped and node keeps all its elements.
+  void split(Node* node) {
+    Node* upper = node_of(create_node(node));
+    size_t keep = node->count / 2;
+    T* values = node->values();
+    try {
+      for (size_t i = keep; i < node->count; ++i) {
+        node_alloc_traits::construct(allocator_, upper->values() + upper->count,
+                                     std::move(values[i]));
+        ++upper->count;
+      }
+    } catch (...) {
+      destroy_values(upper);
+      destroy_node(upper);
+      throw;
+    }
+    while (node->count > keep) {
+      node_alloc_traits::destroy(allocator_, values + --node->count);
+    }
+  }
+
+  // Folds the next node into node when together they fill at most half a
+  // node, and does the same with the previous node, so nodes stay dense
+  // under erasure. Returns the iterator to what was at (node, index).
+  iterator rebalance(Node* node, size_t index) {
+    BaseNode* next = node->next;
+    if (next != &fakeNode_ &&
+        node->count + next->count <= kNodeCapacity / 2) {
+      absorb(node, node_of(next));
+    }
+    BaseNode* prev = node->prev;
+    if (prev != &fakeNode_ &&
+        prev->count + node->count <= kNodeCapacity / 2) {
+      index += prev->count;
+      absorb(node_of(prev), node);
+      node = node_of(prev);
+    }
+    if (index == node->count) {
+      return iterator(node->next, 0);
+    }
+    return iterator(node, index);
+  }
+  // Appends every element of from to into and frees from. The originals are
+  // only destroyed once all moves succeeded; if one throws, the copies are
+  // dropped and both nodes keep their elements.
+  void absorb(Node* into, Node* from) {
+    T* values = from->values();
+    size_t into_count = into->count;
+    try {
+      for (size_t i = 0; i < from->count; ++i) {
+        node_alloc_traits::construct(allocator_, into->values() + into->count,
+                                     std::move(values[i]));
+        ++into->count;
+      }
+    } catch (...) {
+      while (into->count > into_count) {
+        node_alloc_traits::destroy(allocator_, into->values() + --into->count);
+      }
+      throw;
+    }
+    destroy_values(from);
+    destroy_node(from);
+  }
+
+  void swap_nodes(UnrolledList& other) noexcept {
+    std::swap(size_, other.size_);
+    std::swap(node_count_, other.node_count_);
+    std::swap(fakeNode_.next, other.fakeNode_.next);
+    std::swap(fakeNode_.prev, other.fakeNode_.prev);
+    for (UnrolledList* list : {this, &other}) {
+      BaseNode& fake = list->fakeNode_;
+      if (list->node_count_ > 0) {
+        fake.next->prev = &fake;
+        fake.prev->next = &fake;
+      } else {
+        fake.next = &fake;
+        fake.prev = &fake;
+      }
+    }
+  }
+};
@@ -1,111 +1,827 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+struct BlockedMultiplication {};
+
+template <size_t Cutoff = 64>
+struct StrassenMultiplication {
+  static constexpr size_t kCutoff = Cutoff;
+};
+
+template <size_t N, size_t M, typename T>
+class TransposedView;
+template <size_t N, typename T>
+class LuDecomposition;
+template <size_t N, size_t M, typename T>
+class MappedMatrix;
+
+namespace tmp {
+const size_t kBlockSize = 64;
+const size_t kTransposeTile = 8;
+const size_t kInlineElements = 16;
+
+template <typename T>
+constexpr void MultiplyAdd(const T* lhs, size_t lhs_stride, const T* rhs,
+                           size_t rhs_stride, T* out, size_t out_stride,
+                           size_t rows, size_t inner, size_t columns);
+template <size_t M, size_t Z, typename T, size_t... Cells>
+constexpr void MultiplyUnrolled(const T* lhs, const T* rhs, T* out,
+                                std::index_sequence<Cells...>);
+template <typename T>
+void StrassenMultiply(const T* lhs, size_t lhs_stride, const T* rhs,
+                      size_t rhs_stride, T* out, size_t out_stride, size_t size,
+                      size_t cutoff);
+template <typename T>
+void MultiplyTransposedAdd(const T* lhs, size_t lhs_stride, const T* rhs,
+                           size_t rhs_stride, T* out, size_t out_stride,
+                           size_t rows, size_t inner, size_t columns);
+template <typename T>
+void TransposedMultiplyAdd(const T* lhs, size_t lhs_stride, const T* rhs,
+                           size_t rhs_stride, T* out, size_t out_stride,
+                           size_t rows, size_t inner, size_t columns);
+template <typename T>
+constexpr void TransposeBlock(const T* in, size_t in_stride, T* out,
+                              size_t out_stride, size_t rows, size_t columns);
+template <typename T>
+constexpr void TransposeInPlace(T* data, size_t stride, size_t size);
+template <size_t N, typename T>
+constexpr T SmallDeterminant(std::array<T, N * N> data);
+}  // namespace tmp
+
 template <size_t N, size_t M, typename T = int64_t>
 class Matrix {
  public:
-  Matrix() : data_(N, std::vector<T>(M, T())) {};
-  Matrix(const std::vector<std::vector<T>>& vec) : data_(vec) {};
-  Matrix(const T& elem) : data_(N, std::vector<T>(M, elem)) {};
-  T& operator()(size_t row, size_t column);
+  constexpr Matrix() : Matrix(T()) {};
+  constexpr Matrix(const std::vector<std::vector<T>>& vec);
+  // Preferred for braced rows such as Matrix<2, 2>({{1, 2}, {3, 4}}): unlike
+  // the vector overload it allocates nothing, so it also works in constant
+  // initialisation.
+  constexpr Matrix(std::initializer_list<std::initializer_list<T>> rows);
+  constexpr Matrix(const T& elem);
+  constexpr T& operator()(size_t row, size_t column);
+  constexpr const T& operator()(size_t row, size_t column) const;
+  constexpr bool operator==(const Matrix<N, M, T>& other) const;
+  constexpr Matrix<N, M, T>& operator+=(const Matrix<N, M, T>& other);
+  constexpr Matrix<N, M, T> operator+(const Matrix<N, M, T>& other) const;
+  constexpr Matrix<N, M, T>& operator-=(const Matrix<N, M, T>& other);
+  constexpr Matrix<N, M, T> operator-(const Matrix<N, M, T>& other) const;
+  constexpr Matrix<N, M, T> operator*(const T& elem) const;
+  template <size_t Z>
+  constexpr Matrix<N, Z, T> operator*(const Matrix<M, Z, T>& other) const;
+  template <size_t Z>
+  Matrix<N, Z, T> operator*(const TransposedView<M, Z, T>& other) const;
+  template <typename Policy = BlockedMultiplication, size_t Z>
+  Matrix<N, Z, T> Multiply(const Matrix<M, Z, T>& other) const;
+  constexpr Matrix<M, N, T> Transposed() const;
+  // The view refers to this matrix, so it cannot be taken of a temporary.
+  TransposedView<M, N, T> LazyTransposed() const&;
+  TransposedView<M, N, T> LazyTransposed() const&& = delete;
+  constexpr void Transpose();
+  Matrix<N, M, T> Pow(uint64_t power) const;
+  constexpr T Trace() const;
+  // Constexpr for matrices small enough to be stored inline, which also
+  // accept integer and other exact element types; larger ones go through
+  // LuDecomposition and must be floating point.
+  constexpr T Determinant() const;
+  Matrix<N, M, T> Inverse() const;
+
+ private:
+  template <size_t, size_t, typename>
+  friend class Matrix;
+  template <size_t, size_t, typename>
+  friend class TransposedView;
+  template <size_t, typename>
+  friend class LuDecomposition;
+  template <size_t, size_t, typename>
+  friend class MappedMatrix;
+
+  // Small matrices keep their elements inline, which makes them usable in
+  // constant expressions and free of heap allocations.
+  static constexpr bool kInline = N * M <= tmp::kInlineElements;
+  using Storage =
+      std::conditional_t<kInline, std::array<T, N * M>, std::vector<T>>;
+
+  Storage data_{};
+};
+
+// Non-owning N x M view of a Matrix<M, N, T> read as its transpose. Products
+// with a view read the underlying rows directly instead of materializing it.
+template <size_t N, size_t M, typename T = int64_t>
+class TransposedView {
+ public:
+  TransposedView(const Matrix<M, N, T>& matrix) : matrix_(matrix) {};
+  TransposedView(const Matrix<M, N, T>&& matrix) = delete;
   const T& operator()(size_t row, size_t column) const;
-  bool operator==(const Matrix<N, M, T>& other) const;
-  Matrix<N, M, T>& operator+=(const Matrix<N, M, T>& other);
-  Matrix<N, M, T> operator+(const Matrix<N, M, T>& other) const;
-  Matrix<N, M, T>& operator-=(const Matrix<N, M, T>& other);
-  Matrix<N, M, T> operator-(const Matrix<N, M, T>& other) const;
-  Matrix<N, M, T> operator*(const T& elem) const;
   template <size_t Z>
-  Matrix<N, Z, T> operator*(const Matrix<M, Z, T>& other);
-  Matrix<M, N, T> Transposed() const;
-  T Trace() const;
+  Matrix<N, Z, T> operator*(const Matrix<M, Z, T>& other) const;
+  Matrix<N, M, T> ToMatrix() const;
+
+ private:
+  template <size_t, size_t, typename>
+  friend class Matrix;
+
+  const Matrix<M, N, T>& matrix_;
+};
+
+// PA = LU with partial pivoting, L unit lower triangular. Factorizes once so
+// several right-hand sides can be solved against the same matrix.
+template <size_t N, typename T = double>
+class LuDecomposition {
+ public:
+  LuDecomposition(const Matrix<N, N, T>& matrix);
+  bool IsSingular() const;
+  T Determinant() const;
+  template <size_t K>
+  Matrix<N, K, T> Solve(const Matrix<N, K, T>& rhs) const;
+  Matrix<N, N, T> Inverse() const;
 
  private:
-  std::vector<std::vector<T>> data_;
+  Matrix<N, N, T> lu_;
+  std::vector<size_t> pivots_;
+  bool odd_permutation_ = false;
+  bool singular_ = false;
 };
 
+template <size_t N, size_t K, typename T>
+Matrix<N, K, T> Solve(const Matrix<N, N, T>& matrix,
+                      const Matrix<N, K, T>& rhs);
+
+template <size_t N, size_t M, typename T>
+constexpr Matrix<N, M, T>::Matrix(const std::vector<std::vector<T>>& vec)
+    : Matrix() {
+  for (size_t i = 0; i < N; ++i) {
+    std::copy_n(vec[i].begin(), M, data_.begin() + i * M);
+  }
+}
+template <size_t N, size_t M, typename T>
+constexpr Matrix<N, M, T>::Matrix(
+    std::initializer_list<std::initializer_list<T>> rows)
+    : Matrix() {
+  size_t i = 0;
+  for (const auto& row : rows) {
+    std::copy_n(row.begin(), M, data_.begin() + i++ * M);
+  }
+}
+template <size_t N, size_t M, typename T>
+constexpr Matrix<N, M, T>::Matrix(const T& elem) {
+  if constexpr (kInline) {
+    data_.fill(elem);
+  } else {
+    data_.assign(N * M, elem);
+  }
+}
 template <size_t N, size_t M, typename T>
-T& Matrix<N, M, T>::operator()(size_t row, size_t column) {
-  return data_[row][column];
+constexpr T& Matrix<N, M, T>::operator()(size_t row, size_t column) {
+  return data_[row * M + column];
 }
 template <size_t N, size_t M, typename T>
-const T& Matrix<N, M, T>::operator()(size_t row, size_t column) const {
-  return data_[row][column];
+constexpr const T& Matrix<N, M, T>::operator()(size_t row,
+                                                   size_t column) const {
+  return data_[row * M + column];
 }
 template <size_t N, size_t M, typename T>
-bool Matrix<N, M, T>::operator==(const Matrix<N, M, T>& other) const {
+constexpr bool Matrix<N, M, T>::operator==(
+    const Matrix<N, M, T>& other) const {
   return data_ == other.data_;
 }
 template <size_t N, size_t M, typename T>
-Matrix<N, M, T>& Matrix<N, M, T>::operator+=(const Matrix<N, M, T>& other) {
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < M; ++j) {
-      data_[i][j] += other(i, j);
-    }
+constexpr Matrix<N, M, T>& Matrix<N, M, T>::operator+=(
+    const Matrix<N, M, T>& other) {
+  for (size_t i = 0; i < N * M; ++i) {
+    data_[i] += other.data_[i];
   }
   return *this;
 }
 template <size_t N, size_t M, typename T>
-Matrix<N, M, T> Matrix<N, M, T>::operator+(const Matrix<N, M, T>& other) const {
-  Matrix<N, M, T> new_matrix(data_);
+constexpr Matrix<N, M, T> Matrix<N, M, T>::operator+(
+    const Matrix<N, M, T>& other) const {
+  Matrix<N, M, T> new_matrix(*this);
   new_matrix += other;
   return new_matrix;
 }
 template <size_t N, size_t M, typename T>
-Matrix<N, M, T>& Matrix<N, M, T>::operator-=(const Matrix<N, M, T>& other) {
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < M; ++j) {
-      data_[i][j] -= other(i, j);
-    }
+constexpr Matrix<N, M, T>& Matrix<N, M, T>::operator-=(
+    const Matrix<N, M, T>& other) {
+  for (size_t i = 0; i < N * M; ++i) {
+    data_[i] -= other.data_[i];
   }
   return *this;
 }
 template <size_t N, size_t M, typename T>
-Matrix<N, M, T> Matrix<N, M, T>::operator-(const Matrix<N, M, T>& other) const {
-  Matrix<N, M, T> new_matrix(data_);
+constexpr Matrix<N, M, T> Matrix<N, M, T>::operator-(
+    const Matrix<N, M, T>& other) const {
+  Matrix<N, M, T> new_matrix(*this);
   new_matrix -= other;
   return new_matrix;
 }
 template <size_t N, size_t M, typename T>
-Matrix<N, M, T> Matrix<N, M, T>::operator*(const T& elem) const {
+constexpr Matrix<N, M, T> Matrix<N, M, T>::operator*(const T& elem) const {
   Matrix<N, M, T> new_matrix;
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < M; ++j) {
-      new_matrix(i, j) = data_[i][j] * elem;
-    }
+  for (size_t i = 0; i < N * M; ++i) {
+    new_matrix.data_[i] = data_[i] * elem;
   }
   return new_matrix;
 }
 template <size_t N, size_t M, typename T>
 template <size_t Z>
-Matrix<N, Z, T> Matrix<N, M, T>::operator*(const Matrix<M, Z, T>& other) {
+constexpr Matrix<N, Z, T> Matrix<N, M, T>::operator*(
+    const Matrix<M, Z, T>& other) const {
   Matrix<N, Z, T> new_matrix;
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < Z; ++j) {
-      for (size_t k = 0; k < M; ++k) {
-        new_matrix(i, j) += data_[i][k] * other(k, j);
-      }
-    }
+  if constexpr (N <= 4 && M <= 4 && Z <= 4) {
+    tmp::MultiplyUnrolled<M, Z>(data_.data(), other.data_.data(),
+                                new_matrix.data_.data(),
+                                std::make_index_sequence<N * Z>());
+  } else {
+    tmp::MultiplyAdd(data_.data(), M, other.data_.data(), Z,
+                     new_matrix.data_.data(), Z, N, M, Z);
   }
   return new_matrix;
 }
 template <size_t N, size_t M, typename T>
-Matrix<M, N, T> Matrix<N, M, T>::Transposed() const {
-  Matrix<M, N, T> new_matrix;
-  for (size_t i = 0; i < N; ++i) {
-    for (size_t j = 0; j < M; ++j) {
-      new_matrix(j, i) = data_[i][j];
+template <size_t Z>
+Matrix<N, Z, T> Matrix<N, M, T>::operator*(
+    const TransposedView<M, Z, T>& other) const {
+  Matrix<N, Z, T> new_matrix;
+  tmp::MultiplyTransposedAdd(data_.data(), M, other.matrix_.data_.data(), M,
+                             new_matrix.data_.data(), Z, N, M, Z);
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+template <typename Policy, size_t Z>
+Matrix<N, Z, T> Matrix<N, M, T>::Multiply(const Matrix<M, Z, T>& other) const {
+  if constexpr (std::is_same_v<Policy, BlockedMultiplication>) {
+    return *this * other;
+  } else {
+    static_assert(N == M && M == Z);
+    static_assert(Policy::kCutoff > 0);
+    size_t base = N;
+    size_t scale = 1;
+    while (base > Policy::kCutoff) {
+      base = (base + 1) / 2;
+      scale *= 2;
+    }
+    if (scale == 1) {
+      return *this * other;
+    }
+    Matrix<N, Z, T> new_matrix;
+    size_t padded = base * scale;
+    if (padded == N) {
+      tmp::StrassenMultiply(data_.data(), N, other.data_.data(), N,
+                            new_matrix.data_.data(), N, N, Policy::kCutoff);
+      return new_matrix;
     }
+    std::vector<T> lhs(padded * padded, T());
+    std::vector<T> rhs(padded * padded, T());
+    std::vector<T> out(padded * padded, T());
+    for (size_t i = 0; i < N; ++i) {
+      std::copy_n(data_.begin() + i * N, N, lhs.begin() + i * padded);
+      std::copy_n(other.data_.begin() + i * N, N, rhs.begin() + i * padded);
+    }
+    tmp::StrassenMultiply(lhs.data(), padded, rhs.data(), padded, out.data(),
+                          padded, padded, Policy::kCutoff);
+    for (size_t i = 0; i < N; ++i) {
+      std::copy_n(out.begin() + i * padded, N,
+                  new_matrix.data_.begin() + i * N);
+    }
+    return new_matrix;
   }
+}
+template <size_t N, size_t M, typename T>
+constexpr Matrix<M, N, T> Matrix<N, M, T>::Transposed() const {
+  Matrix<M, N, T> new_matrix;
+  tmp::TransposeBlock(data_.data(), M, new_matrix.data_.data(), N, N, M);
   return new_matrix;
 }
 template <size_t N, size_t M, typename T>
-T Matrix<N, M, T>::Trace() const {
+TransposedView<M, N, T> Matrix<N, M, T>::LazyTransposed() const& {
+  return TransposedView<M, N, T>(*this);
+}
+template <size_t N, size_t M, typename T>
+constexpr void Matrix<N, M, T>::Transpose() {
+  static_assert(N == M);
+  tmp::TransposeInPlace(data_.data(), N, N);
+}
+// Binary exponentiation over three flat buffers that are swapped after each
+// product, so the loop itself never allocates.
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> Matrix<N, M, T>::Pow(uint64_t power) const {
+  static_assert(N == M);
+  Matrix<N, M, T> answer;
+  if (power == 0) {
+    for (size_t i = 0; i < N; ++i) {
+      answer(i, i) = T(1);
+    }
+    return answer;
+  }
+  Storage base(data_);
+  Storage scratch(data_);
+  bool answer_is_identity = true;
+  while (true) {
+    if (power % 2 == 1) {
+      if (answer_is_identity) {
+        std::copy(base.begin(), base.end(), answer.data_.begin());
+        answer_is_identity = false;
+      } else {
+        std::fill(scratch.begin(), scratch.end(), T());
+        tmp::MultiplyAdd(answer.data_.data(), N, base.data(), N,
+                         scratch.data(), N, N, N, N);
+        answer.data_.swap(scratch);
+      }
+    }
+    power /= 2;
+    if (power == 0) {
+      return answer;
+    }
+    std::fill(scratch.begin(), scratch.end(), T());
+    tmp::MultiplyAdd(base.data(), N, base.data(), N, scratch.data(), N, N, N,
+                     N);
+    base.swap(scratch);
+  }
+}
+template <size_t N, size_t M, typename T>
+constexpr T Matrix<N, M, T>::Trace() const {
   static_assert(N == M);
   T answer{};
   for (size_t i = 0; i < N; ++i) {
-    answer += data_[i][i];
+    answer += (*this)(i, i);
+  }
+  return answer;
+}
+
+template <size_t N, size_t M, typename T>
+const T& TransposedView<N, M, T>::operator()(size_t row, size_t column) const {
+  return matrix_(column, row);
+}
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+Matrix<N, Z, T> TransposedView<N, M, T>::operator*(
+    const Matrix<M, Z, T>& other) const {
+  Matrix<N, Z, T> new_matrix;
+  tmp::TransposedMultiplyAdd(matrix_.data_.data(), N, other.data_.data(), Z,
+                             new_matrix.data_.data(), Z, N, M, Z);
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> TransposedView<N, M, T>::ToMatrix() const {
+  return matrix_.Transposed();
+}
+
+template <size_t N, typename T>
+LuDecomposition<N, T>::LuDecomposition(const Matrix<N, N, T>& matrix)
+    : lu_(matrix), pivots_(N) {
+  static_assert(std::is_floating_point_v<T>);
+  T* a = lu_.data_.data();
+  std::vector<T> panel;
+  for (size_t kk = 0; kk < N; kk += tmp::kBlockSize) {
+    size_t k_end = std::min(N, kk + tmp::kBlockSize);
+    for (size_t j = kk; j < k_end; ++j) {
+      size_t pivot = j;
+      for (size_t i = j + 1; i < N; ++i) {
+        if (std::abs(a[i * N + j]) > std::abs(a[pivot * N + j])) {
+          pivot = i;
+        }
+      }
+      pivots_[j] = pivot;
+      if (pivot != j) {
+        std::swap_ranges(a + j * N, a + (j + 1) * N, a + pivot * N);
+        odd_permutation_ = !odd_permutation_;
+      }
+      if (a[j * N + j] == T()) {
+        singular_ = true;
+        continue;
+      }
+      for (size_t i = j + 1; i < N; ++i) {
+        a[i * N + j] /= a[j * N + j];
+        const T factor = a[i * N + j];
+        for (size_t c = j + 1; c < k_end; ++c) {
+          a[i * N + c] -= factor * a[j * N + c];
+        }
+      }
+    }
+    if (k_end == N) {
+      break;
+    }
+    for (size_t j = kk; j < k_end; ++j) {
+      for (size_t i = j + 1; i < k_end; ++i) {
+        const T factor = a[i * N + j];
+        for (size_t c = k_end; c < N; ++c) {
+          a[i * N + c] -= factor * a[j * N + c];
+        }
+      }
+    }
+    size_t width = k_end - kk;
+    size_t rest = N - k_end;
+    panel.resize(rest * width);
+    for (size_t i = 0; i < rest; ++i) {
+      for (size_t j = 0; j < width; ++j) {
+        panel[i * width + j] = -a[(k_end + i) * N + kk + j];
+      }
+    }
+    tmp::MultiplyAdd(panel.data(), width, a + kk * N + k_end, N,
+                     a + k_end * N + k_end, N, rest, width, rest);
+  }
+}
+template <size_t N, typename T>
+bool LuDecomposition<N, T>::IsSingular() const {
+  return singular_;
+}
+template <size_t N, typename T>
+T LuDecomposition<N, T>::Determinant() const {
+  if (singular_) {
+    return T();
+  }
+  T answer = odd_permutation_ ? T(-1) : T(1);
+  for (size_t i = 0; i < N; ++i) {
+    answer *= lu_(i, i);
+  }
+  return answer;
+}
+template <size_t N, typename T>
+template <size_t K>
+Matrix<N, K, T> LuDecomposition<N, T>::Solve(
+    const Matrix<N, K, T>& rhs) const {
+  if (singular_) {
+    throw std::domain_error("singular matrix");
+  }
+  Matrix<N, K, T> answer(rhs);
+  T* x = answer.data_.data();
+  const T* a = lu_.data_.data();
+  for (size_t i = 0; i < N; ++i) {
+    if (pivots_[i] != i) {
+      std::swap_ranges(x + i * K, x + (i + 1) * K, x + pivots_[i] * K);
+    }
+  }
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t k = 0; k < i; ++k) {
+      const T factor = a[i * N + k];
+      for (size_t j = 0; j < K; ++j) {
+        x[i * K + j] -= factor * x[k * K + j];
+      }
+    }
+  }
+  for (size_t i = N; i-- > 0;) {
+    for (size_t k = i + 1; k < N; ++k) {
+      const T factor = a[i * N + k];
+      for (size_t j = 0; j < K; ++j) {
+        x[i * K + j] -= factor * x[k * K + j];
+      }
+    }
+    for (size_t j = 0; j < K; ++j) {
+      x[i * K + j] /= a[i * N + i];
+    }
   }
   return answer;
 }
+template <size_t N, typename T>
+Matrix<N, N, T> LuDecomposition<N, T>::Inverse() const {
+  Matrix<N, N, T> identity;
+  for (size_t i = 0; i < N; ++i) {
+    identity(i, i) = T(1);
+  }
+  return Solve(identity);
+}
+template <size_t N, size_t M, typename T>
+constexpr T Matrix<N, M, T>::Determinant() const {
+  static_assert(N == M);
+  if constexpr (kInline) {
+    return tmp::SmallDeterminant<N>(data_);
+  } else {
+    return LuDecomposition<N, T>(*this).Determinant();
+  }
+}
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> Matrix<N, M, T>::Inverse() const {
+  static_assert(N == M);
+  return LuDecomposition<N, T>(*this).Inverse();
+}
+template <size_t N, size_t K, typename T>
+Matrix<N, K, T> Solve(const Matrix<N, N, T>& matrix,
+                      const Matrix<N, K, T>& rhs) {
+  return LuDecomposition<N, T>(matrix).Solve(rhs);
+}
+
+namespace tmp {
+template <typename T>
+constexpr void MultiplyAdd(const T* lhs, size_t lhs_stride, const T* rhs,
+                           size_t rhs_stride, T* out, size_t out_stride,
+                           size_t rows, size_t inner, size_t columns) {
+  for (size_t ii = 0; ii < rows; ii += kBlockSize) {
+    size_t i_end = std::min(rows, ii + kBlockSize);
+    for (size_t kk = 0; kk < inner; kk += kBlockSize) {
+      size_t k_end = std::min(inner, kk + kBlockSize);
+      for (size_t jj = 0; jj < columns; jj += kBlockSize) {
+        size_t j_end = std::min(columns, jj + kBlockSize);
+        for (size_t i = ii; i < i_end; ++i) {
+          T* out_row = out + i * out_stride;
+          for (size_t k = kk; k < k_end; ++k) {
+            const T elem = lhs[i * lhs_stride + k];
+            const T* rhs_row = rhs + k * rhs_stride;
+            for (size_t j = jj; j < j_end; ++j) {
+              out_row[j] += elem * rhs_row[j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// out = lhs * rhs with every multiply-add spelled out at compile time.
+template <size_t Row, size_t Column, size_t M, size_t Z, typename T,
+          size_t... Ks>
+constexpr T DotUnrolled(const T* lhs, const T* rhs,
+                        std::index_sequence<Ks...>) {
+  return ((lhs[Row * M + Ks] * rhs[Ks * Z + Column]) + ...);
+}
+template <size_t M, size_t Z, typename T, size_t... Cells>
+constexpr void MultiplyUnrolled(const T* lhs, const T* rhs, T* out,
+                                std::index_sequence<Cells...>) {
+  ((out[Cells] = DotUnrolled<Cells / Z, Cells % Z, M, Z>(
+        lhs, rhs, std::make_index_sequence<M>())),
+   ...);
+}
+
+template <typename T>
+void AddBlocks(const T* lhs, size_t lhs_stride, const T* rhs,
+               size_t rhs_stride, T* out, size_t out_stride, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    for (size_t j = 0; j < size; ++j) {
+      out[i * out_stride + j] =
+          lhs[i * lhs_stride + j] + rhs[i * rhs_stride + j];
+    }
+  }
+}
+
+template <typename T>
+void SubtractBlocks(const T* lhs, size_t lhs_stride, const T* rhs,
+                    size_t rhs_stride, T* out, size_t out_stride, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    for (size_t j = 0; j < size; ++j) {
+      out[i * out_stride + j] =
+          lhs[i * lhs_stride + j] - rhs[i * rhs_stride + j];
+    }
+  }
+}
+
+// Winograd variant of Strassen: 7 products and 15 additions per level, with
+// only two temporaries of the quadrant size (schedule of Douglas et al.).
+// Writes lhs * rhs into out, size must be cutoff-sized times a power of two.
+template <typename T>
+void StrassenMultiply(const T* lhs, size_t lhs_stride, const T* rhs,
+                      size_t rhs_stride, T* out, size_t out_stride, size_t size,
+                      size_t cutoff) {
+  if (size <= cutoff || size % 2 != 0) {
+    for (size_t i = 0; i < size; ++i) {
+      std::fill_n(out + i * out_stride, size, T());
+    }
+    MultiplyAdd(lhs, lhs_stride, rhs, rhs_stride, out, out_stride, size, size,
+                size);
+    return;
+  }
+  size_t half = size / 2;
+  const T* a11 = lhs;
+  const T* a12 = lhs + half;
+  const T* a21 = lhs + half * lhs_stride;
+  const T* a22 = a21 + half;
+  const T* b11 = rhs;
+  const T* b12 = rhs + half;
+  const T* b21 = rhs + half * rhs_stride;
+  const T* b22 = b21 + half;
+  T* c11 = out;
+  T* c12 = out + half;
+  T* c21 = out + half * out_stride;
+  T* c22 = c21 + half;
+  std::vector<T> x_buffer(half * half);
+  std::vector<T> y_buffer(half * half);
+  T* x = x_buffer.data();
+  T* y = y_buffer.data();
+
+  SubtractBlocks(a11, lhs_stride, a21, lhs_stride, x, half, half);
+  SubtractBlocks(b22, rhs_stride, b12, rhs_stride, y, half, half);
+  StrassenMultiply(x, half, y, half, c21, out_stride, half, cutoff);
+  AddBlocks(a21, lhs_stride, a22, lhs_stride, x, half, half);
+  SubtractBlocks(b12, rhs_stride, b11, rhs_stride, y, half, half);
+  StrassenMultiply(x, half, y, half, c22, out_stride, half, cutoff);
+  SubtractBlocks(x, half, a11, lhs_stride, x, half, half);
+  SubtractBlocks(b22, rhs_stride, y, half, y, half, half);
+  StrassenMultiply(x, half, y, half, c12, out_stride, half, cutoff);
+  SubtractBlocks(a12, lhs_stride, x, half, x, half, half);
+  StrassenMultiply(x, half, b22, rhs_stride, c11, out_stride, half, cutoff);
+  StrassenMultiply(a11, lhs_stride, b11, rhs_stride, x, half, half, cutoff);
+  AddBlocks(x, half, c12, out_stride, c12, out_stride, half);
+  AddBlocks(c12, out_stride, c21, out_stride, c21, out_stride, half);
+  AddBlocks(c12, out_stride, c22, out_stride, c12, out_stride, half);
+  AddBlocks(c21, out_stride, c22, out_stride, c22, out_stride, half);
+  AddBlocks(c12, out_stride, c11, out_stride, c12, out_stride, half);
+  SubtractBlocks(y, half, b21, rhs_stride, y, half, half);
+  StrassenMultiply(a22, lhs_stride, y, half, c11, out_stride, half, cutoff);
+  SubtractBlocks(c21, out_stride, c11, out_stride, c21, out_stride, half);
+  StrassenMultiply(a12, lhs_stride, b21, rhs_stride, c11, out_stride, half,
+                   cutoff);
+  AddBlocks(x, half, c11, out_stride, c11, out_stride, half);
+}
+
+// out += lhs * rhs^T, where rhs is stored as columns x inner: every output
+// element is a dot product of two contiguous rows.
+template <typename T>
+void MultiplyTransposedAdd(const T* lhs, size_t lhs_stride, const T* rhs,
+                           size_t rhs_stride, T* out, size_t out_stride,
+                           size_t rows, size_t inner, size_t columns) {
+  for (size_t kk = 0; kk < inner; kk += kBlockSize) {
+    size_t k_end = std::min(inner, kk + kBlockSize);
+    for (size_t ii = 0; ii < rows; ii += kBlockSize) {
+      size_t i_end = std::min(rows, ii + kBlockSize);
+      for (size_t jj = 0; jj < columns; jj += kBlockSize) {
+        size_t j_end = std::min(columns, jj + kBlockSize);
+        for (size_t i = ii; i < i_end; ++i) {
+          const T* lhs_row = lhs + i * lhs_stride;
+          for (size_t j = jj; j < j_end; ++j) {
+            const T* rhs_row = rhs + j * rhs_stride;
+            T sum = out[i * out_stride + j];
+            for (size_t k = kk; k < k_end; ++k) {
+              sum += lhs_row[k] * rhs_row[k];
+            }
+            out[i * out_stride + j] = sum;
+          }
+        }
+      }
+    }
+  }
+}
+
+// out += lhs^T * rhs, where lhs is stored as inner x rows.
+template <typename T>
+void TransposedMultiplyAdd(const T* lhs, size_t lhs_stride, const T* rhs,
+                           size_t rhs_stride, T* out, size_t out_stride,
+                           size_t rows, size_t inner, size_t columns) {
+  for (size_t ii = 0; ii < rows; ii += kBlockSize) {
+    size_t i_end = std::min(rows, ii + kBlockSize);
+    for (size_t kk = 0; kk < inner; kk += kBlockSize) {
+      size_t k_end = std::min(inner, kk + kBlockSize);
+      for (size_t jj = 0; jj < columns; jj += kBlockSize) {
+        size_t j_end = std::min(columns, jj + kBlockSize);
+        for (size_t k = kk; k < k_end; ++k) {
+          const T* rhs_row = rhs + k * rhs_stride;
+          for (size_t i = ii; i < i_end; ++i) {
+            const T elem = lhs[k * lhs_stride + i];
+            T* out_row = out + i * out_stride;
+            for (size_t j = jj; j < j_end; ++j) {
+              out_row[j] += elem * rhs_row[j];
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Cache-oblivious transpose: halve the longer side until the block fits a
+// tile. Full tiles use constant bounds so the compiler can keep them in
+// registers and emit shuffles.
+template <typename T>
+constexpr void TransposeBlock(const T* in, size_t in_stride, T* out,
+                              size_t out_stride, size_t rows, size_t columns) {
+  if (rows == kTransposeTile && columns == kTransposeTile) {
+    for (size_t i = 0; i < kTransposeTile; ++i) {
+      for (size_t j = 0; j < kTransposeTile; ++j) {
+        out[j * out_stride + i] = in[i * in_stride + j];
+      }
+    }
+    return;
+  }
+  if (rows <= kTransposeTile && columns <= kTransposeTile) {
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < columns; ++j) {
+        out[j * out_stride + i] = in[i * in_stride + j];
+      }
+    }
+    return;
+  }
+  if (rows >= columns) {
+    size_t half = std::max(kTransposeTile, rows / 2 / kTransposeTile *
+                                               kTransposeTile);
+    TransposeBlock(in, in_stride, out, out_stride, half, columns);
+    TransposeBlock(in + half * in_stride, in_stride, out + half, out_stride,
+                   rows - half, columns);
+  } else {
+    size_t half = std::max(kTransposeTile, columns / 2 / kTransposeTile *
+                                               kTransposeTile);
+    TransposeBlock(in, in_stride, out, out_stride, rows, half);
+    TransposeBlock(in + half, in_stride, out + half * out_stride, out_stride,
+                   rows, columns - half);
+  }
+}
+
+// Swaps the rows x columns block at upper with the transpose of the
+// columns x rows block at lower.
+template <typename T>
+constexpr void SwapTransposedBlocks(T* upper, T* lower, size_t stride,
+                                    size_t rows, size_t columns) {
+  if (rows <= kTransposeTile && columns <= kTransposeTile) {
+    for (size_t i = 0; i < rows; ++i) {
+      for (size_t j = 0; j < columns; ++j) {
+        std::swap(upper[i * stride + j], lower[j * stride + i]);
+      }
+    }
+    return;
+  }
+  if (rows >= columns) {
+    size_t half = rows / 2;
+    SwapTransposedBlocks(upper, lower, stride, half, columns);
+    SwapTransposedBlocks(upper + half * stride, lower + half, stride,
+                         rows - half, columns);
+  } else {
+    size_t half = columns / 2;
+    SwapTransposedBlocks(upper, lower, stride, rows, half);
+    SwapTransposedBlocks(upper + half, lower + half * stride, stride, rows,
+                         columns - half);
+  }
+}
+
+template <typename T>
+constexpr void TransposeInPlace(T* data, size_t stride, size_t size) {
+  if (size <= kTransposeTile) {
+    for (size_t i = 0; i < size; ++i) {
+      for (size_t j = i + 1; j < size; ++j) {
+        std::swap(data[i * stride + j], data[j * stride + i]);
+      }
+    }
+    return;
+  }
+  size_t half = size / 2;
+  TransposeInPlace(data, stride, half);
+  TransposeInPlace(data + half * stride + half, stride, size - half);
+  SwapTransposedBlocks(data + half, data + half * stride, stride, half,
+                       size - half);
+}
+
+// std::abs only becomes constexpr in C++23.
+template <typename T>
+constexpr T Magnitude(T value) {
+  return value < T(0) ? -value : value;
+}
+
+// Floating point eliminates with partial pivoting. Other types use Bareiss'
+// fraction-free elimination, where every division is exact, so integer
+// determinants come out exactly.
+template <size_t N, typename T>
+constexpr T SmallDeterminant(std::array<T, N * N> data) {
+  constexpr bool kFloating = std::is_floating_point_v<T>;
+  bool negate = false;
+  T previous = T(1);
+  for (size_t k = 0; k < N; ++k) {
+    size_t pivot = k;
+    for (size_t i = k + 1; i < N; ++i) {
+      if constexpr (kFloating) {
+        if (Magnitude(data[i * N + k]) > Magnitude(data[pivot * N + k])) {
+          pivot = i;
+        }
+      } else if (data[pivot * N + k] == T(0)) {
+        pivot = i;
+      }
+    }
+    if (data[pivot * N + k] == T(0)) {
+      return T(0);
+    }
+    if (pivot != k) {
+      for (size_t j = k; j < N; ++j) {
+        std::swap(data[k * N + j], data[pivot * N + j]);
+      }
+      negate = !negate;
+    }
+    const T& diagonal = data[k * N + k];
+    for (size_t i = k + 1; i < N; ++i) {
+      for (size_t j = k + 1; j < N; ++j) {
+        if constexpr (kFloating) {
+          data[i * N + j] -= data[i * N + k] / diagonal * data[k * N + j];
+        } else {
+          data[i * N + j] = (data[i * N + j] * diagonal -
+                             data[i * N + k] * data[k * N + j]) /
+                            previous;
+        }
+      }
+    }
+    previous = diagonal;
+  }
+  T answer = T(1);
+  if constexpr (kFloating) {
+    for (size_t i = 0; i < N; ++i) {
+      answer *= data[i * N + i];
+    }
+  } else {
+    answer = data[N * N - 1];
+  }
+  return negate ? -answer : answer;
+}
+}  // namespace tmp
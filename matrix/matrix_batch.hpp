@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "matrix.hpp"
+
+namespace tmp {
+const size_t kBatchChunk = 256;
+}  // namespace tmp
+
+// Many independent N x M matrices in structure-of-arrays layout: element
+// (row, column) of every matrix forms one contiguous lane, so each kernel
+// runs its innermost loop across the batch and vectorizes regardless of how
+// small N and M are. Lanes are walked in chunks that stay in cache.
+template <size_t N, size_t M, typename T = int64_t>
+class MatrixBatch {
+ public:
+  MatrixBatch(size_t count) : count_(count), data_(N * M * count, T()) {};
+  size_t Size() const;
+  T& operator()(size_t index, size_t row, size_t column);
+  const T& operator()(size_t index, size_t row, size_t column) const;
+  Matrix<N, M, T> Get(size_t index) const;
+  void Set(size_t index, const Matrix<N, M, T>& matrix);
+  MatrixBatch<N, M, T>& operator+=(const MatrixBatch<N, M, T>& other);
+  MatrixBatch<N, M, T> operator+(const MatrixBatch<N, M, T>& other) const;
+  MatrixBatch<N, M, T>& operator-=(const MatrixBatch<N, M, T>& other);
+  MatrixBatch<N, M, T> operator-(const MatrixBatch<N, M, T>& other) const;
+  template <size_t Z>
+  MatrixBatch<N, Z, T> operator*(const MatrixBatch<M, Z, T>& other) const;
+  MatrixBatch<M, N, T> Transposed() const;
+
+ private:
+  template <size_t, size_t, typename>
+  friend class MatrixBatch;
+
+  T* Lane(size_t row, size_t column);
+  const T* Lane(size_t row, size_t column) const;
+  void CheckSize(size_t count) const;
+
+  size_t count_;
+  std::vector<T> data_;
+};
+
+template <size_t N, size_t M, typename T>
+size_t MatrixBatch<N, M, T>::Size() const {
+  return count_;
+}
+template <size_t N, size_t M, typename T>
+T& MatrixBatch<N, M, T>::operator()(size_t index, size_t row, size_t column) {
+  return Lane(row, column)[index];
+}
+template <size_t N, size_t M, typename T>
+const T& MatrixBatch<N, M, T>::operator()(size_t index, size_t row,
+                                          size_t column) const {
+  return Lane(row, column)[index];
+}
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> MatrixBatch<N, M, T>::Get(size_t index) const {
+  Matrix<N, M, T> matrix;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      matrix(i, j) = Lane(i, j)[index];
+    }
+  }
+  return matrix;
+}
+template <size_t N, size_t M, typename T>
+void MatrixBatch<N, M, T>::Set(size_t index, const Matrix<N, M, T>& matrix) {
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      Lane(i, j)[index] = matrix(i, j);
+    }
+  }
+}
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T>& MatrixBatch<N, M, T>::operator+=(
+    const MatrixBatch<N, M, T>& other) {
+  CheckSize(other.count_);
+  for (size_t i = 0; i < data_.size(); ++i) {
+    data_[i] += other.data_[i];
+  }
+  return *this;
+}
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T> MatrixBatch<N, M, T>::operator+(
+    const MatrixBatch<N, M, T>& other) const {
+  MatrixBatch<N, M, T> new_batch(*this);
+  new_batch += other;
+  return new_batch;
+}
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T>& MatrixBatch<N, M, T>::operator-=(
+    const MatrixBatch<N, M, T>& other) {
+  CheckSize(other.count_);
+  for (size_t i = 0; i < data_.size(); ++i) {
+    data_[i] -= other.data_[i];
+  }
+  return *this;
+}
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T> MatrixBatch<N, M, T>::operator-(
+    const MatrixBatch<N, M, T>& other) const {
+  MatrixBatch<N, M, T> new_batch(*this);
+  new_batch -= other;
+  return new_batch;
+}
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+MatrixBatch<N, Z, T> MatrixBatch<N, M, T>::operator*(
+    const MatrixBatch<M, Z, T>& other) const {
+  CheckSize(other.count_);
+  MatrixBatch<N, Z, T> new_batch(count_);
+  for (size_t first = 0; first < count_; first += tmp::kBatchChunk) {
+    size_t last = std::min(count_, first + tmp::kBatchChunk);
+    for (size_t i = 0; i < N; ++i) {
+      for (size_t j = 0; j < Z; ++j) {
+        T* out = new_batch.Lane(i, j);
+        for (size_t k = 0; k < M; ++k) {
+          const T* lhs = Lane(i, k);
+          const T* rhs = other.Lane(k, j);
+          for (size_t b = first; b < last; ++b) {
+            out[b] += lhs[b] * rhs[b];
+          }
+        }
+      }
+    }
+  }
+  return new_batch;
+}
+template <size_t N, size_t M, typename T>
+MatrixBatch<M, N, T> MatrixBatch<N, M, T>::Transposed() const {
+  MatrixBatch<M, N, T> new_batch(count_);
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      std::copy_n(Lane(i, j), count_, new_batch.Lane(j, i));
+    }
+  }
+  return new_batch;
+}
+template <size_t N, size_t M, typename T>
+T* MatrixBatch<N, M, T>::Lane(size_t row, size_t column) {
+  return data_.data() + (row * M + column) * count_;
+}
+template <size_t N, size_t M, typename T>
+const T* MatrixBatch<N, M, T>::Lane(size_t row, size_t column) const {
+  return data_.data() + (row * M + column) * count_;
+}
+template <size_t N, size_t M, typename T>
+void MatrixBatch<N, M, T>::CheckSize(size_t count) const {
+  if (count != count_) {
+    throw std::invalid_argument("batch sizes differ");
+  }
+}
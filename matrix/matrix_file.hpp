@@ -0,0 +1,248 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "matrix.hpp"
+
+// On-disk layout: a MatrixFileHeader followed by zero padding up to
+// data_offset, then rows * columns elements in row-major host byte order.
+// data_offset is a multiple of kMatrixFileAlignment so the mapped elements
+// are suitably aligned for vector loads.
+struct MatrixFileHeader {
+  char magic[8];
+  uint64_t rows;
+  uint64_t columns;
+  uint32_t element_size;
+  uint32_t element_kind;
+  uint64_t data_offset;
+};
+
+namespace tmp {
+const char kMatrixFileMagic[8] = {'M', 'A', 'T', 'R', 'I', 'X', '0', '1'};
+const uint64_t kMatrixFileAlignment = 64;
+
+template <size_t N, size_t M, typename T>
+MatrixFileHeader MakeMatrixFileHeader();
+}  // namespace tmp
+
+template <size_t N, size_t M, typename T = int64_t>
+class MatrixWriter {
+ public:
+  MatrixWriter(const std::string& path);
+  MatrixWriter(const MatrixWriter& other) = delete;
+  MatrixWriter& operator=(const MatrixWriter& other) = delete;
+  ~MatrixWriter();
+
+  void WriteRow(const T* row);
+  void WriteRow(const std::vector<T>& row);
+  void Close();
+
+ private:
+  std::ofstream out_;
+  size_t rows_written_ = 0;
+};
+
+// Read-only view of a matrix file mapped into memory. Nothing is copied on
+// open; pages are faulted in as the kernels touch them.
+template <size_t N, size_t M, typename T = int64_t>
+class MappedMatrix {
+ public:
+  MappedMatrix(const std::string& path);
+  MappedMatrix(const MappedMatrix& other) = delete;
+  MappedMatrix(MappedMatrix&& other) noexcept;
+  MappedMatrix& operator=(const MappedMatrix& other) = delete;
+  ~MappedMatrix();
+
+  const T& operator()(size_t row, size_t column) const;
+  const T* Data() const;
+  template <size_t Z>
+  Matrix<N, Z, T> operator*(const Matrix<M, Z, T>& other) const;
+  Matrix<N, M, T> ToMatrix() const;
+
+ private:
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  const T* data_ = nullptr;
+};
+
+template <size_t N, size_t M, typename T>
+void SaveBinary(const Matrix<N, M, T>& matrix, const std::string& path);
+
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> LoadBinary(const std::string& path);
+
+template <size_t N, size_t M, typename T>
+MatrixFileHeader tmp::MakeMatrixFileHeader() {
+  static_assert(std::is_arithmetic_v<T>);
+  MatrixFileHeader header{};
+  std::memcpy(header.magic, kMatrixFileMagic, sizeof(header.magic));
+  header.rows = N;
+  header.columns = M;
+  header.element_size = sizeof(T);
+  header.element_kind = std::is_floating_point_v<T> ? 2
+                        : std::is_signed_v<T>       ? 1
+                                                    : 0;
+  header.data_offset = (sizeof(MatrixFileHeader) + kMatrixFileAlignment - 1) /
+                       kMatrixFileAlignment * kMatrixFileAlignment;
+  return header;
+}
+
+template <size_t N, size_t M, typename T>
+MatrixWriter<N, M, T>::MatrixWriter(const std::string& path)
+    : out_(path, std::ios::binary | std::ios::trunc) {
+  if (!out_) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  MatrixFileHeader header = tmp::MakeMatrixFileHeader<N, M, T>();
+  std::vector<char> prefix(header.data_offset, '\0');
+  std::memcpy(prefix.data(), &header, sizeof(header));
+  out_.write(prefix.data(), prefix.size());
+}
+
+template <size_t N, size_t M, typename T>
+MatrixWriter<N, M, T>::~MatrixWriter() {
+  try {
+    if (out_.is_open()) {
+      out_.close();
+    }
+  } catch (...) {
+  }
+}
+
+template <size_t N, size_t M, typename T>
+void MatrixWriter<N, M, T>::WriteRow(const T* row) {
+  if (rows_written_ == N) {
+    throw std::out_of_range("too many rows");
+  }
+  out_.write(reinterpret_cast<const char*>(row), M * sizeof(T));
+  if (!out_) {
+    throw std::runtime_error("write failed");
+  }
+  ++rows_written_;
+}
+
+template <size_t N, size_t M, typename T>
+void MatrixWriter<N, M, T>::WriteRow(const std::vector<T>& row) {
+  if (row.size() != M) {
+    throw std::invalid_argument("bad row size");
+  }
+  WriteRow(row.data());
+}
+
+template <size_t N, size_t M, typename T>
+void MatrixWriter<N, M, T>::Close() {
+  if (rows_written_ != N) {
+    throw std::runtime_error("matrix is incomplete");
+  }
+  out_.close();
+  if (!out_) {
+    throw std::runtime_error("write failed");
+  }
+}
+
+template <size_t N, size_t M, typename T>
+MappedMatrix<N, M, T>::MappedMatrix(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("cannot stat " + path);
+  }
+  MatrixFileHeader expected = tmp::MakeMatrixFileHeader<N, M, T>();
+  mapping_size_ = expected.data_offset + N * M * sizeof(T);
+  if (static_cast<size_t>(info.st_size) < mapping_size_) {
+    ::close(fd);
+    throw std::runtime_error("truncated matrix file " + path);
+  }
+  mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = nullptr;
+    throw std::runtime_error("cannot map " + path);
+  }
+  MatrixFileHeader header;
+  std::memcpy(&header, mapping_, sizeof(header));
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.rows != N || header.columns != M ||
+      header.element_size != expected.element_size ||
+      header.element_kind != expected.element_kind ||
+      header.data_offset != expected.data_offset) {
+    ::munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+    throw std::runtime_error("matrix file does not match the requested type");
+  }
+  data_ = reinterpret_cast<const T*>(static_cast<const char*>(mapping_) +
+                                     header.data_offset);
+}
+
+template <size_t N, size_t M, typename T>
+MappedMatrix<N, M, T>::MappedMatrix(MappedMatrix&& other) noexcept
+    : mapping_(other.mapping_),
+      mapping_size_(other.mapping_size_),
+      data_(other.data_) {
+  other.mapping_ = nullptr;
+  other.mapping_size_ = 0;
+  other.data_ = nullptr;
+}
+
+template <size_t N, size_t M, typename T>
+MappedMatrix<N, M, T>::~MappedMatrix() {
+  if (mapping_ != nullptr) {
+    ::munmap(mapping_, mapping_size_);
+  }
+}
+
+template <size_t N, size_t M, typename T>
+const T& MappedMatrix<N, M, T>::operator()(size_t row, size_t column) const {
+  return data_[row * M + column];
+}
+
+template <size_t N, size_t M, typename T>
+const T* MappedMatrix<N, M, T>::Data() const {
+  return data_;
+}
+
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+Matrix<N, Z, T> MappedMatrix<N, M, T>::operator*(
+    const Matrix<M, Z, T>& other) const {
+  Matrix<N, Z, T> new_matrix;
+  tmp::MultiplyAdd(data_, M, other.data_.data(), Z, new_matrix.data_.data(), Z,
+                   N, M, Z);
+  return new_matrix;
+}
+
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> MappedMatrix<N, M, T>::ToMatrix() const {
+  Matrix<N, M, T> new_matrix;
+  std::memcpy(new_matrix.data_.data(), data_, N * M * sizeof(T));
+  return new_matrix;
+}
+
+template <size_t N, size_t M, typename T>
+void SaveBinary(const Matrix<N, M, T>& matrix, const std::string& path) {
+  MatrixWriter<N, M, T> writer(path);
+  for (size_t i = 0; i < N; ++i) {
+    writer.WriteRow(&matrix(i, 0));
+  }
+  writer.Close();
+}
+
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> LoadBinary(const std::string& path) {
+  return MappedMatrix<N, M, T>(path).ToMatrix();
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+namespace tmp {
+// A GCC/Clang extension; __extension__ keeps -pedantic from flagging every use.
+__extension__ typedef unsigned __int128 Uint128;
+}  // namespace tmp
+
+// Residue modulo an odd Mod below 2^62, kept in Montgomery form (x * 2^64 mod
+// Mod) so that multiplication needs no division. Intended as the element type
+// of Matrix, e.g. Matrix<N, N, Modular<998244353>>::Pow.
+template <uint64_t Mod>
+class Modular {
+ public:
+  constexpr Modular() = default;
+  constexpr Modular(int64_t value);
+  constexpr uint64_t Value() const;
+  constexpr Modular& operator+=(const Modular& other);
+  constexpr Modular& operator-=(const Modular& other);
+  constexpr Modular& operator*=(const Modular& other);
+  constexpr Modular operator+(const Modular& other) const;
+  constexpr Modular operator-(const Modular& other) const;
+  constexpr Modular operator*(const Modular& other) const;
+  constexpr Modular operator-() const;
+  constexpr bool operator==(const Modular& other) const;
+  constexpr bool operator!=(const Modular& other) const;
+
+ private:
+  static_assert(Mod % 2 == 1 && Mod < (uint64_t(1) << 62));
+
+  static constexpr uint64_t NegativeInverse();
+  static constexpr uint64_t kNegativeInverse = NegativeInverse();
+  static constexpr uint64_t kRSquared = static_cast<uint64_t>(
+      static_cast<tmp::Uint128>(-Mod % Mod) * (-Mod % Mod) % Mod);
+
+  static constexpr uint64_t Reduce(tmp::Uint128 value);
+
+  uint64_t value_ = 0;
+};
+
+template <uint64_t Mod>
+constexpr Modular<Mod>::Modular(int64_t value) {
+  int64_t remainder = value % static_cast<int64_t>(Mod);
+  if (remainder < 0) {
+    remainder += Mod;
+  }
+  value_ = Reduce(static_cast<tmp::Uint128>(remainder) * kRSquared);
+}
+
+template <uint64_t Mod>
+constexpr uint64_t Modular<Mod>::Value() const {
+  return Reduce(value_);
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod>& Modular<Mod>::operator+=(const Modular& other) {
+  value_ += other.value_;
+  if (value_ >= Mod) {
+    value_ -= Mod;
+  }
+  return *this;
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod>& Modular<Mod>::operator-=(const Modular& other) {
+  value_ = value_ >= other.value_ ? value_ - other.value_
+                                  : value_ + Mod - other.value_;
+  return *this;
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod>& Modular<Mod>::operator*=(const Modular& other) {
+  value_ = Reduce(static_cast<tmp::Uint128>(value_) * other.value_);
+  return *this;
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod> Modular<Mod>::operator+(const Modular& other) const {
+  Modular answer(*this);
+  answer += other;
+  return answer;
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod> Modular<Mod>::operator-(const Modular& other) const {
+  Modular answer(*this);
+  answer -= other;
+  return answer;
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod> Modular<Mod>::operator*(const Modular& other) const {
+  Modular answer(*this);
+  answer *= other;
+  return answer;
+}
+
+template <uint64_t Mod>
+constexpr Modular<Mod> Modular<Mod>::operator-() const {
+  return Modular() - *this;
+}
+
+template <uint64_t Mod>
+constexpr bool Modular<Mod>::operator==(const Modular& other) const {
+  return value_ == other.value_;
+}
+
+template <uint64_t Mod>
+constexpr bool Modular<Mod>::operator!=(const Modular& other) const {
+  return value_ != other.value_;
+}
+
+template <uint64_t Mod>
+constexpr uint64_t Modular<Mod>::NegativeInverse() {
+  uint64_t inverse = Mod;
+  for (int i = 0; i < 5; ++i) {
+    inverse *= 2 - Mod * inverse;
+  }
+  return -inverse;
+}
+
+template <uint64_t Mod>
+constexpr uint64_t Modular<Mod>::Reduce(tmp::Uint128 value) {
+  uint64_t factor = static_cast<uint64_t>(value) * kNegativeInverse;
+  uint64_t answer = static_cast<uint64_t>(
+      (value + static_cast<tmp::Uint128>(factor) * Mod) >> 64);
+  return answer >= Mod ? answer - Mod : answer;
+}
+
+template <uint64_t Mod>
+std::ostream& operator<<(std::ostream& out, const Modular<Mod>& value) {
+  return out << value.Value();
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "matrix.hpp"
+
+template <size_t N, size_t M, typename T>
+class CscMatrix;
+
+template <size_t N, size_t M, typename T = int64_t>
+class CsrMatrix {
+ public:
+  CsrMatrix() : row_offsets_(N + 1, 0) {};
+  CsrMatrix(const Matrix<N, M, T>& matrix);
+  CsrMatrix(const CscMatrix<N, M, T>& matrix);
+  size_t NonZeros() const;
+  T operator()(size_t row, size_t column) const;
+  bool operator==(const CsrMatrix<N, M, T>& other) const;
+  CsrMatrix<N, M, T> operator+(const CsrMatrix<N, M, T>& other) const;
+  template <size_t Z>
+  Matrix<N, Z, T> operator*(const Matrix<M, Z, T>& other) const;
+  template <size_t Z>
+  CsrMatrix<N, Z, T> operator*(const CsrMatrix<M, Z, T>& other) const;
+  CsrMatrix<M, N, T> Transposed() const;
+  Matrix<N, M, T> ToDense() const;
+
+ private:
+  template <size_t, size_t, typename>
+  friend class CsrMatrix;
+  template <size_t, size_t, typename>
+  friend class CscMatrix;
+
+  std::vector<size_t> row_offsets_;
+  std::vector<size_t> columns_;
+  std::vector<T> values_;
+};
+
+// A CSC matrix is stored as the CSR form of its transpose, so every kernel
+// except the dense product is the CSR one applied to swapped operands.
+template <size_t N, size_t M, typename T = int64_t>
+class CscMatrix {
+ public:
+  CscMatrix() = default;
+  CscMatrix(const Matrix<N, M, T>& matrix);
+  CscMatrix(const CsrMatrix<N, M, T>& matrix);
+  size_t NonZeros() const;
+  T operator()(size_t row, size_t column) const;
+  bool operator==(const CscMatrix<N, M, T>& other) const;
+  CscMatrix<N, M, T> operator+(const CscMatrix<N, M, T>& other) const;
+  template <size_t Z>
+  Matrix<N, Z, T> operator*(const Matrix<M, Z, T>& other) const;
+  template <size_t Z>
+  CscMatrix<N, Z, T> operator*(const CscMatrix<M, Z, T>& other) const;
+  CscMatrix<M, N, T> Transposed() const;
+  Matrix<N, M, T> ToDense() const;
+
+ private:
+  template <size_t, size_t, typename>
+  friend class CsrMatrix;
+  template <size_t, size_t, typename>
+  friend class CscMatrix;
+
+  CsrMatrix<M, N, T> transposed_;
+};
+
+template <size_t N, size_t M, typename T>
+CsrMatrix<N, M, T>::CsrMatrix(const Matrix<N, M, T>& matrix)
+    : row_offsets_(N + 1, 0) {
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      if (matrix(i, j) != T()) {
+        columns_.push_back(j);
+        values_.push_back(matrix(i, j));
+      }
+    }
+    row_offsets_[i + 1] = columns_.size();
+  }
+}
+template <size_t N, size_t M, typename T>
+CsrMatrix<N, M, T>::CsrMatrix(const CscMatrix<N, M, T>& matrix)
+    : CsrMatrix(matrix.transposed_.Transposed()) {}
+template <size_t N, size_t M, typename T>
+size_t CsrMatrix<N, M, T>::NonZeros() const {
+  return values_.size();
+}
+template <size_t N, size_t M, typename T>
+T CsrMatrix<N, M, T>::operator()(size_t row, size_t column) const {
+  auto first = columns_.begin() + row_offsets_[row];
+  auto last = columns_.begin() + row_offsets_[row + 1];
+  auto it = std::lower_bound(first, last, column);
+  if (it == last || *it != column) {
+    return T();
+  }
+  return values_[it - columns_.begin()];
+}
+template <size_t N, size_t M, typename T>
+bool CsrMatrix<N, M, T>::operator==(const CsrMatrix<N, M, T>& other) const {
+  return row_offsets_ == other.row_offsets_ && columns_ == other.columns_ &&
+         values_ == other.values_;
+}
+template <size_t N, size_t M, typename T>
+CsrMatrix<N, M, T> CsrMatrix<N, M, T>::operator+(
+    const CsrMatrix<N, M, T>& other) const {
+  CsrMatrix<N, M, T> new_matrix;
+  new_matrix.columns_.reserve(NonZeros() + other.NonZeros());
+  new_matrix.values_.reserve(NonZeros() + other.NonZeros());
+  for (size_t i = 0; i < N; ++i) {
+    size_t p = row_offsets_[i];
+    size_t q = other.row_offsets_[i];
+    while (p < row_offsets_[i + 1] || q < other.row_offsets_[i + 1]) {
+      size_t column;
+      T value;
+      if (q == other.row_offsets_[i + 1] ||
+          (p < row_offsets_[i + 1] && columns_[p] < other.columns_[q])) {
+        column = columns_[p];
+        value = values_[p++];
+      } else if (p == row_offsets_[i + 1] || other.columns_[q] < columns_[p]) {
+        column = other.columns_[q];
+        value = other.values_[q++];
+      } else {
+        column = columns_[p];
+        value = values_[p++] + other.values_[q++];
+      }
+      if (value != T()) {
+        new_matrix.columns_.push_back(column);
+        new_matrix.values_.push_back(value);
+      }
+    }
+    new_matrix.row_offsets_[i + 1] = new_matrix.columns_.size();
+  }
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+Matrix<N, Z, T> CsrMatrix<N, M, T>::operator*(
+    const Matrix<M, Z, T>& other) const {
+  Matrix<N, Z, T> new_matrix;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; ++p) {
+      const T value = values_[p];
+      size_t k = columns_[p];
+      for (size_t j = 0; j < Z; ++j) {
+        new_matrix(i, j) += value * other(k, j);
+      }
+    }
+  }
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+CsrMatrix<N, Z, T> CsrMatrix<N, M, T>::operator*(
+    const CsrMatrix<M, Z, T>& other) const {
+  CsrMatrix<N, Z, T> new_matrix;
+  std::vector<T> accumulator(Z, T());
+  std::vector<size_t> last_row(Z, N);
+  std::vector<size_t> pattern;
+  for (size_t i = 0; i < N; ++i) {
+    pattern.clear();
+    for (size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; ++p) {
+      size_t k = columns_[p];
+      for (size_t q = other.row_offsets_[k]; q < other.row_offsets_[k + 1];
+           ++q) {
+        size_t j = other.columns_[q];
+        if (last_row[j] != i) {
+          last_row[j] = i;
+          accumulator[j] = T();
+          pattern.push_back(j);
+        }
+        accumulator[j] += values_[p] * other.values_[q];
+      }
+    }
+    std::sort(pattern.begin(), pattern.end());
+    for (size_t j : pattern) {
+      if (accumulator[j] != T()) {
+        new_matrix.columns_.push_back(j);
+        new_matrix.values_.push_back(accumulator[j]);
+      }
+    }
+    new_matrix.row_offsets_[i + 1] = new_matrix.columns_.size();
+  }
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+CsrMatrix<M, N, T> CsrMatrix<N, M, T>::Transposed() const {
+  CsrMatrix<M, N, T> new_matrix;
+  new_matrix.columns_.resize(NonZeros());
+  new_matrix.values_.resize(NonZeros());
+  for (size_t column : columns_) {
+    ++new_matrix.row_offsets_[column + 1];
+  }
+  for (size_t j = 0; j < M; ++j) {
+    new_matrix.row_offsets_[j + 1] += new_matrix.row_offsets_[j];
+  }
+  std::vector<size_t> next(new_matrix.row_offsets_.begin(),
+                           new_matrix.row_offsets_.end() - 1);
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; ++p) {
+      size_t position = next[columns_[p]]++;
+      new_matrix.columns_[position] = i;
+      new_matrix.values_[position] = values_[p];
+    }
+  }
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> CsrMatrix<N, M, T>::ToDense() const {
+  Matrix<N, M, T> new_matrix;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t p = row_offsets_[i]; p < row_offsets_[i + 1]; ++p) {
+      new_matrix(i, columns_[p]) = values_[p];
+    }
+  }
+  return new_matrix;
+}
+
+template <size_t N, size_t M, typename T>
+CscMatrix<N, M, T>::CscMatrix(const Matrix<N, M, T>& matrix)
+    : transposed_(matrix.Transposed()) {}
+template <size_t N, size_t M, typename T>
+CscMatrix<N, M, T>::CscMatrix(const CsrMatrix<N, M, T>& matrix)
+    : transposed_(matrix.Transposed()) {}
+template <size_t N, size_t M, typename T>
+size_t CscMatrix<N, M, T>::NonZeros() const {
+  return transposed_.NonZeros();
+}
+template <size_t N, size_t M, typename T>
+T CscMatrix<N, M, T>::operator()(size_t row, size_t column) const {
+  return transposed_(column, row);
+}
+template <size_t N, size_t M, typename T>
+bool CscMatrix<N, M, T>::operator==(const CscMatrix<N, M, T>& other) const {
+  return transposed_ == other.transposed_;
+}
+template <size_t N, size_t M, typename T>
+CscMatrix<N, M, T> CscMatrix<N, M, T>::operator+(
+    const CscMatrix<N, M, T>& other) const {
+  CscMatrix<N, M, T> new_matrix;
+  new_matrix.transposed_ = transposed_ + other.transposed_;
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+Matrix<N, Z, T> CscMatrix<N, M, T>::operator*(
+    const Matrix<M, Z, T>& other) const {
+  Matrix<N, Z, T> new_matrix;
+  const auto& offsets = transposed_.row_offsets_;
+  for (size_t k = 0; k < M; ++k) {
+    for (size_t p = offsets[k]; p < offsets[k + 1]; ++p) {
+      const T value = transposed_.values_[p];
+      size_t i = transposed_.columns_[p];
+      for (size_t j = 0; j < Z; ++j) {
+        new_matrix(i, j) += value * other(k, j);
+      }
+    }
+  }
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+template <size_t Z>
+CscMatrix<N, Z, T> CscMatrix<N, M, T>::operator*(
+    const CscMatrix<M, Z, T>& other) const {
+  CscMatrix<N, Z, T> new_matrix;
+  new_matrix.transposed_ = other.transposed_ * transposed_;
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+CscMatrix<M, N, T> CscMatrix<N, M, T>::Transposed() const {
+  CscMatrix<M, N, T> new_matrix;
+  new_matrix.transposed_ = transposed_.Transposed();
+  return new_matrix;
+}
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> CscMatrix<N, M, T>::ToDense() const {
+  return transposed_.ToDense().Transposed();
+}
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <iostream>
 #include <memory>
 #include <type_traits>
@@ -9,13 +10,24 @@ struct ControlBlockTag {};
 template <typename U, typename T>
 concept ConvertibleFromUStar = std::is_convertible_v<U*, T*>;
 
+// Counts are atomic so that SharedPtr and WeakPtr copies may be made and
+// dropped from different threads. The owners together hold one weak
+// reference, released after the object is destroyed, so whichever of the last
+// owner and the last WeakPtr finishes second frees the block.
 struct BaseControlBlock {
-  size_t shared_count;
-  size_t weak_count;
+  std::atomic<size_t> shared_count;
+  std::atomic<size_t> weak_count;
   BaseControlBlock() = default;
   BaseControlBlock(size_t shared, size_t weak);
   virtual ~BaseControlBlock() = default;
 
+  void add_shared();
+  // Takes a new owner only while the object is alive.
+  bool try_add_shared();
+  void release_shared();
+  void add_weak();
+  void release_weak();
+
   virtual void destroy_control_block() = 0;
   virtual void destroy_obj() = 0;
   virtual void* get() = 0;
@@ -108,6 +120,9 @@ class SharedPtr {
 template <typename T>
 class WeakPtr {
  public:
+  template <typename U>
+  friend class WeakPtr;
+
   WeakPtr() = default;
   WeakPtr(const WeakPtr& other);
 
@@ -142,13 +157,50 @@ SharedPtr<T> MakeShared(Args&&... args);
 template <typename T, typename Alloc, typename... Args>
 SharedPtr<T> AllocateShared(const Alloc& alloc, Args&&... args);
 
-BaseControlBlock::BaseControlBlock(size_t shared, size_t weak)
+inline BaseControlBlock::BaseControlBlock(size_t shared, size_t weak)
     : shared_count(shared), weak_count(weak) {}
 
+// A new reference is always made from an existing one, which keeps the block
+// alive, so increments need no ordering.
+inline void BaseControlBlock::add_shared() {
+  shared_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline bool BaseControlBlock::try_add_shared() {
+  size_t count = shared_count.load(std::memory_order_relaxed);
+  do {
+    if (count == 0) {
+      return false;
+    }
+  } while (!shared_count.compare_exchange_weak(count, count + 1,
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_relaxed));
+  return true;
+}
+
+// The acq_rel decrement makes every owner's use of the object happen before
+// its destruction by whichever owner drops the count to zero.
+inline void BaseControlBlock::release_shared() {
+  if (shared_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    destroy_obj();
+    release_weak();
+  }
+}
+
+inline void BaseControlBlock::add_weak() {
+  weak_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void BaseControlBlock::release_weak() {
+  if (weak_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    destroy_control_block();
+  }
+}
+
 template <typename T, typename U, typename Deleter, typename Allocator>
 ControlBlockWithType<T, U, Deleter, Allocator>::ControlBlockWithType(
     U* ptr1, Deleter deleter, Allocator allocator)
-    : BaseControlBlock{1, 0},
+    : BaseControlBlock{1, 1},
       true_ptr(ptr1),
       deleter(std::move(deleter)),
       allocator(std::move(allocator)) {}
@@ -177,7 +229,7 @@ template <typename T, typename Allocator>
 template <typename... Args>
 ControlBlockMakeShared<T, Allocator>::ControlBlockMakeShared(
     Allocator allocator1, Args&&... args)
-    : BaseControlBlock{1, 0}, allocator(std::move(allocator1)) {
+    : BaseControlBlock{1, 1}, allocator(std::move(allocator1)) {
   ::new (static_cast<void*>(storage)) T(std::forward<Args>(args)...);
 }
 
@@ -240,7 +292,7 @@ SharedPtr<T>::SharedPtr(const SharedPtr<U>& other) {
 }
 
 template <typename T>
-SharedPtr<T>::SharedPtr(SharedPtr&& other) : ptr_(other.ptr_), cb_(other.cb_) {
+SharedPtr<T>::SharedPtr(SharedPtr&& other) : cb_(other.cb_), ptr_(other.ptr_) {
   other.ptr_ = nullptr;
   other.cb_ = nullptr;
 }
@@ -248,7 +300,7 @@ SharedPtr<T>::SharedPtr(SharedPtr&& other) : ptr_(other.ptr_), cb_(other.cb_) {
 template <typename T>
 template <ConvertibleFromUStar<T> U>
 SharedPtr<T>::SharedPtr(SharedPtr<U>&& other)
-    : ptr_(other.ptr_), cb_(other.cb_) {
+    : cb_(other.cb_), ptr_(other.ptr_) {
   other.ptr_ = nullptr;
   other.cb_ = nullptr;
 }
@@ -353,31 +405,25 @@ size_t SharedPtr<T>::use_count() const {
   if (cb_ == nullptr) {
     return 0;
   }
-  return cb_->shared_count;
+  return cb_->shared_count.load(std::memory_order_relaxed);
 }
 
 template <typename T>
 SharedPtr<T>::SharedPtr([[maybe_unused]] tmp::ControlBlockTag tag1, T* ptr,
                         BaseControlBlock* new_cb)
-    : ptr_(ptr), cb_(new_cb) {}
+    : cb_(new_cb), ptr_(ptr) {}
 
 template <typename T>
 void SharedPtr<T>::shared_count_plus() {
   if (cb_ != nullptr) {
-    ++cb_->shared_count;
+    cb_->add_shared();
   }
 }
 
 template <typename T>
 void SharedPtr<T>::shared_count_minus() {
   if (cb_ != nullptr) {
-    cb_->shared_count--;
-    if (cb_->shared_count == 0) {
-      cb_->destroy_obj();
-      if (cb_->weak_count == 0) {
-        cb_->destroy_control_block();
-      }
-    }
+    cb_->release_shared();
   }
 }
 
@@ -395,14 +441,12 @@ WeakPtr<T>::WeakPtr(const WeakPtr<U>& other) {
 
 template <typename T>
 WeakPtr<T>::WeakPtr(WeakPtr&& other) : cb_(other.cb_) {
-  other.ptr_ = nullptr;
   other.cb_ = nullptr;
 }
 
 template <typename T>
 template <ConvertibleFromUStar<T> U>
 WeakPtr<T>::WeakPtr(WeakPtr<U>&& other) : cb_(other.cb_) {
-  other.ptr_ = nullptr;
   other.cb_ = nullptr;
 }
 
@@ -434,7 +478,6 @@ WeakPtr<T>& WeakPtr<T>::operator=(WeakPtr&& other) noexcept {
     minus_weak_count();
     cb_ = other.cb_;
     other.cb_ = nullptr;
-    other.ptr_ = nullptr;
   }
   return *this;
 }
@@ -446,29 +489,31 @@ WeakPtr<T>::~WeakPtr() {
 
 template <typename T>
 bool WeakPtr<T>::expired() const {
-  return cb_ == nullptr || cb_->shared_count == 0;
+  return cb_ == nullptr ||
+         cb_->shared_count.load(std::memory_order_acquire) == 0;
 }
 
 template <typename T>
 SharedPtr<T> WeakPtr<T>::lock() {
-  ++cb_->shared_count;
+  // Checking expired() and then incrementing would race with the last owner
+  // going away, so the count is only bumped while it is still non-zero.
+  if (cb_ == nullptr || !cb_->try_add_shared()) {
+    return SharedPtr<T>();
+  }
   return SharedPtr<T>(tmp::ControlBlockTag{}, static_cast<T*>(cb_->get()), cb_);
 }
 
 template <typename T>
 void WeakPtr<T>::plus_weak_count() {
   if (cb_ != nullptr) {
-    ++cb_->weak_count;
+    cb_->add_weak();
   }
 }
 
 template <typename T>
 void WeakPtr<T>::minus_weak_count() {
   if (cb_ != nullptr) {
-    --cb_->weak_count;
-    if (cb_->weak_count == 0 && cb_->shared_count == 0) {
-      cb_->destroy_control_block();
-    }
+    cb_->release_weak();
   }
 }
 
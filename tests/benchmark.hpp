@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Benchmarks are built next to the tests but not run by ctest. They print the
+// fastest of a few runs after one warm-up run; numbers are only meaningful in
+// an optimised build, which they get by default when no build type is set.
+
+// Benchmarks fold their results into this, so the optimiser cannot drop the
+// measured work.
+inline volatile uint64_t benchmark_sink = 0;
+
+template <typename Func>
+double Measure(const std::string& name, Func func, int repeats = 3) {
+  func();
+  double best = 0;
+  for (int i = 0; i < repeats; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+  }
+  std::cout << std::left << std::setw(60) << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(2) << best
+            << " ms" << std::endl;
+  return best;
+}
+
+inline void Section(const std::string& title) {
+  std::cout << "\n" << title << "\n";
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Unlike assert, stays active in release builds.
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: "       \
+                << #condition << std::endl;                                \
+      std::abort();                                                        \
+    }                                                                      \
+  } while (false)
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deque/blocking_queue.hpp"
+#include "deque/deque.hpp"
+#include "deque/work_stealing_deque.hpp"
+#include "tests/benchmark.hpp"
+
+namespace {
+
+// Push and iterate throughput as the element grows; every run moves the same
+// number of bytes.
+template <size_t Size>
+void BenchmarkElementSize() {
+  using Element = std::array<char, Size>;
+  const size_t kCount = (64 << 20) / Size;
+  std::string label = std::to_string(Size) + "-byte elements";
+  auto run = [kCount](auto& container) {
+    container.resize(0);
+    for (size_t i = 0; i < kCount; ++i) {
+      container.push_back(Element{static_cast<char>(i)});
+    }
+    uint64_t sum = 0;
+    for (const Element& element : container) {
+      sum += static_cast<unsigned char>(element[0]);
+    }
+    benchmark_sink = benchmark_sink + sum;
+  };
+  Deque<Element> deque;
+  std::deque<Element> reference;
+  Measure("Deque, " + label, [&] { run(deque); });
+  Measure("std::deque, " + label, [&] { run(reference); });
+}
+
+size_t bucket_allocations = 0;
+
+template <typename T>
+struct CountingAllocator : std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    using other = CountingAllocator<U>;
+  };
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) {}
+
+  T* allocate(size_t count) {
+    ++bucket_allocations;
+    return std::allocator<T>::allocate(count);
+  }
+};
+
+// Queue traffic crossing bucket boundaries, with and without spare buckets.
+void BenchmarkSpareBuckets() {
+  const int kRounds = 10'000'000;
+  for (size_t spares : {size_t(0), size_t(4)}) {
+    Deque<int, CountingAllocator<int>, 64> deque;
+    deque.set_max_spare_buckets(spares);
+    for (int i = 0; i < 100; ++i) {
+      deque.push_back(i);
+    }
+    bucket_allocations = 0;
+    Measure("10M push_back/pop_front, " + std::to_string(spares) +
+                " spare buckets",
+            [&] {
+              for (int i = 0; i < kRounds; ++i) {
+                deque.push_back(i);
+                deque.pop_front();
+              }
+            },
+            1);
+    std::cout << "  bucket allocations: " << bucket_allocations << std::endl;
+  }
+}
+
+template <typename Container>
+void RandomEdits(Container& container, std::mt19937& gen, int edits) {
+  for (int i = 0; i < edits; ++i) {
+    size_t position = gen() % (container.size() + 1);
+    if (i % 2 == 0) {
+      container.insert(container.begin() + position, i);
+    } else if (position < container.size()) {
+      container.erase(container.begin() + position);
+    }
+  }
+  benchmark_sink = benchmark_sink + container.size();
+}
+
+void BenchmarkRandomEdits() {
+  const int kSize = 200'000;
+  const int kEdits = 20'000;
+  Deque<int> deque(kSize, 1);
+  std::deque<int> reference(kSize, 1);
+  std::vector<int> vector(kSize, 1);
+  std::mt19937 gen(37);
+  Measure("Deque, 20k edits at random positions",
+          [&] { RandomEdits(deque, gen, kEdits); });
+  Measure("std::deque, 20k edits at random positions",
+          [&] { RandomEdits(reference, gen, kEdits); });
+  Measure("std::vector, 20k edits at random positions",
+          [&] { RandomEdits(vector, gen, kEdits); });
+
+  std::vector<int> range(1000, 2);
+  Measure("Deque, 1k range inserts and erases of 1000", [&] {
+    for (int i = 0; i < 1000; ++i) {
+      size_t position = gen() % deque.size();
+      deque.insert(deque.begin() + position, range.begin(), range.end());
+      deque.erase(deque.begin() + position,
+                  deque.begin() + position + range.size());
+    }
+  });
+  Measure("std::deque, 1k range inserts and erases of 1000", [&] {
+    for (int i = 0; i < 1000; ++i) {
+      size_t position = gen() % reference.size();
+      reference.insert(reference.begin() + position, range.begin(),
+                       range.end());
+      reference.erase(reference.begin() + position,
+                      reference.begin() + position + range.size());
+    }
+  });
+}
+
+void BenchmarkSegmentedAlgorithms() {
+  const int kSize = 10'000'000;
+  Deque<int> deque(kSize, 1);
+  deque[kSize - 1] = 2;
+  std::vector<int> out(kSize);
+  Measure("accumulate over iterators", [&] {
+    benchmark_sink = std::accumulate(deque.begin(), deque.end(), uint64_t(0));
+  });
+  Measure("segmented::accumulate", [&] {
+    benchmark_sink =
+        segmented::accumulate(deque.begin(), deque.end(), uint64_t(0));
+  });
+  Measure("find over iterators", [&] {
+    benchmark_sink = std::find(deque.begin(), deque.end(), 2) - deque.begin();
+  });
+  Measure("segmented::find", [&] {
+    benchmark_sink =
+        segmented::find(deque.begin(), deque.end(), 2) - deque.begin();
+  });
+  Measure("copy over iterators", [&] {
+    std::copy(deque.begin(), deque.end(), out.begin());
+    benchmark_sink = benchmark_sink + out.back();
+  });
+  Measure("segmented::copy", [&] {
+    segmented::copy(deque.begin(), deque.end(), out.begin());
+    benchmark_sink = benchmark_sink + out.back();
+  });
+}
+
+void BenchmarkBulkConstruction() {
+  const size_t kSize = 10'000'000;
+  Deque<int> source(kSize, 7);
+  std::deque<int> reference_source(kSize, 7);
+  Measure("Deque(10M, value)",
+          [&] { benchmark_sink = Deque<int>(kSize, 7).size(); });
+  Measure("std::deque(10M, value)",
+          [&] { benchmark_sink = std::deque<int>(kSize, 7).size(); });
+  Measure("Deque copy of 10M", [&] { benchmark_sink = Deque(source).size(); });
+  Measure("std::deque copy of 10M",
+          [&] { benchmark_sink = std::deque(reference_source).size(); });
+}
+
+void BenchmarkIterators() {
+  const size_t kSize = 5'000'000;
+  std::mt19937 gen(41);
+  std::vector<int> values(kSize);
+  for (int& value : values) {
+    value = static_cast<int>(gen());
+  }
+  Measure("std::sort of 5M, Deque", [&] {
+    Deque<int> deque(values.begin(), values.end());
+    std::sort(deque.begin(), deque.end());
+    benchmark_sink = benchmark_sink + deque[kSize / 2];
+  }, 1);
+  Measure("std::sort of 5M, std::vector", [&] {
+    std::vector<int> vector(values);
+    std::sort(vector.begin(), vector.end());
+    benchmark_sink = benchmark_sink + vector[kSize / 2];
+  }, 1);
+
+  std::vector<int> sorted(values);
+  std::sort(sorted.begin(), sorted.end());
+  Deque<int> deque(sorted.begin(), sorted.end());
+  auto search = [&](auto first, auto last) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < 2'000'000; ++i) {
+      sum += std::lower_bound(first, last, values[i]) - first;
+    }
+    benchmark_sink = sum;
+  };
+  Measure("2M binary searches, Deque",
+          [&] { search(deque.cbegin(), deque.cend()); });
+  Measure("2M binary searches, std::vector",
+          [&] { search(sorted.cbegin(), sorted.cend()); });
+}
+
+// Fork-join sum: tasks are halved ranges packed into one word; each worker
+// splits its own tasks and steals from a random victim when it runs dry.
+void BenchmarkForkJoin(int workers) {
+  const uint64_t kLeaves = 1 << 16;
+  const uint64_t kLeafWork = 2000;
+  std::vector<WorkStealingDeque<uint64_t>> deques(workers);
+  std::atomic<uint64_t> leaves_done{0};
+  std::atomic<uint64_t> total{0};
+  auto work = [&](int self) {
+    std::mt19937 gen(self);
+    uint64_t sum = 0;
+    while (leaves_done.load(std::memory_order_relaxed) < kLeaves) {
+      std::optional<uint64_t> task = deques[self].pop();
+      if (!task) {
+        task = deques[gen() % workers].steal();
+        if (!task) {
+          continue;
+        }
+      }
+      uint64_t first = *task >> 32;
+      uint64_t last = *task & 0xffffffff;
+      while (last - first > 1) {
+        uint64_t middle = first + (last - first) / 2;
+        deques[self].push(middle << 32 | last);
+        last = middle;
+      }
+      for (uint64_t i = 0; i < kLeafWork; ++i) {
+        sum += (first * kLeafWork + i) % 7;
+      }
+      leaves_done.fetch_add(1, std::memory_order_relaxed);
+    }
+    total.fetch_add(sum);
+  };
+  Measure("fork-join, " + std::to_string(workers) + " workers", [&] {
+    leaves_done = 0;
+    deques[0].push(kLeaves);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; ++i) {
+      threads.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    benchmark_sink = total.load();
+  });
+}
+
+// The single-lock queue BlockingQueue replaces.
+template <typename T>
+class MutexQueue {
+ public:
+  explicit MutexQueue(size_t capacity) : capacity_(capacity) {}
+
+  void push(T value) {
+    std::unique_lock lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+    queue_.push_back(std::move(value));
+    not_empty_.notify_one();
+  }
+  T pop() {
+    std::unique_lock lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty(); });
+    T value = std::move(queue_.front());
+    queue_.pop_front();
+    not_full_.notify_one();
+    return value;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> queue_;
+  size_t capacity_;
+};
+
+template <typename Queue>
+void RunProducersConsumers(Queue& queue, int pairs, int per_producer) {
+  std::atomic<uint64_t> sum{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < pairs; ++p) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < per_producer; ++i) {
+        queue.push(i);
+      }
+    });
+    threads.emplace_back([&] {
+      uint64_t local = 0;
+      for (int i = 0; i < per_producer; ++i) {
+        local += queue.pop();
+      }
+      sum.fetch_add(local);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  benchmark_sink = sum.load();
+}
+
+void BenchmarkQueues() {
+  const int kItems = 1 << 20;
+  for (int pairs : {1, 2, 4, 8, 16}) {
+    std::string label = std::to_string(2 * pairs) + " threads";
+    Measure("BlockingQueue, " + label, [&] {
+      BlockingQueue<int> queue(1024);
+      RunProducersConsumers(queue, pairs, kItems / pairs);
+    }, 1);
+    Measure("single-mutex queue, " + label, [&] {
+      MutexQueue<int> queue(1024);
+      RunProducersConsumers(queue, pairs, kItems / pairs);
+    }, 1);
+  }
+}
+
+}  // namespace
+
+int main() {
+  Section("Bucket size by element size, 64 MiB pushed and iterated");
+  BenchmarkElementSize<4>();
+  BenchmarkElementSize<16>();
+  BenchmarkElementSize<64>();
+  BenchmarkElementSize<256>();
+
+  Section("Spare buckets");
+  BenchmarkSpareBuckets();
+
+  Section("Random-position edits");
+  BenchmarkRandomEdits();
+
+  Section("Segmented algorithms over 10M ints");
+  BenchmarkSegmentedAlgorithms();
+
+  Section("Bulk construction");
+  BenchmarkBulkConstruction();
+
+  Section("Iterator arithmetic");
+  BenchmarkIterators();
+
+  Section("Work stealing");
+  int cores =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  for (int workers = 1; workers <= cores; workers *= 2) {
+    BenchmarkForkJoin(workers);
+  }
+
+  Section("Producers and consumers, 1M items");
+  BenchmarkQueues();
+}
@@ -0,0 +1,650 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <numeric>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "deque/blocking_queue.hpp"
+#include "deque/deque.hpp"
+#include "deque/work_stealing_deque.hpp"
+#include "tests/check.hpp"
+
+namespace {
+
+template <typename T, typename Allocator, size_t BucketSize>
+void CheckSame(const Deque<T, Allocator, BucketSize>& deque,
+               const std::deque<T>& reference) {
+  CHECK(deque.size() == reference.size());
+  CHECK(std::equal(deque.cbegin(), deque.cend(), reference.begin(),
+                   reference.end()));
+}
+
+void TestDequeMatchesStdDeque() {
+  std::mt19937 gen(34);
+  Deque<int, std::allocator<int>, 4> deque;
+  std::deque<int> reference;
+  for (int op = 0; op < 20000; ++op) {
+    int value = static_cast<int>(gen() % 1000);
+    size_t position = reference.empty() ? 0 : gen() % (reference.size() + 1);
+    switch (gen() % 7) {
+      case 0:
+      case 1:
+        deque.push_back(value);
+        reference.push_back(value);
+        break;
+      case 2:
+        deque.push_front(value);
+        reference.push_front(value);
+        break;
+      case 3:
+        if (!reference.empty()) {
+          deque.pop_front();
+          reference.pop_front();
+        }
+        break;
+      case 4:
+        if (!reference.empty()) {
+          deque.pop_back();
+          reference.pop_back();
+        }
+        break;
+      case 5:
+        deque.insert(deque.begin() + position, 3, value);
+        reference.insert(reference.begin() + position, 3, value);
+        break;
+      case 6:
+        if (position < reference.size()) {
+          deque.erase(deque.begin() + position);
+          reference.erase(reference.begin() + position);
+        }
+        break;
+    }
+  }
+  CheckSame(deque, reference);
+  std::sort(deque.begin(), deque.end());
+  std::sort(reference.begin(), reference.end());
+  CheckSame(deque, reference);
+  CHECK(std::binary_search(deque.begin(), deque.end(), reference.front()));
+}
+
+int live_elements = 0;
+
+// Counts live instances, so destroying one twice or not at all shows up.
+struct Tracked {
+  explicit Tracked(int value) : value(value) { ++live_elements; }
+  Tracked(const Tracked& other) : value(other.value) { ++live_elements; }
+  Tracked& operator=(const Tracked& other) = default;
+  ~Tracked() { --live_elements; }
+
+  int value;
+};
+
+void TestDequeBucketSizes() {
+  static_assert(DequeBucketSize<char>() == 4096);
+  static_assert(DequeBucketSize<int32_t>() == 1024);
+  static_assert(DequeBucketSize<std::array<char, 100>>() == 32);
+  static_assert(DequeBucketSize<std::array<char, 1000>>() == 16);
+  static_assert(Deque<int32_t>::kBucketSize == 1024);
+  static_assert(Deque<int, std::allocator<int>, 8>::kBucketShift == 3);
+
+  Deque<std::array<char, 1000>> large;
+  for (int i = 0; i < 100; ++i) {
+    large.push_back({static_cast<char>(i)});
+  }
+  CHECK(large.segment_count() == 100 / 16 + 1 && large[99][0] == 99);
+
+  // Emptying the deque from either end destroys each element exactly once.
+  {
+    Deque<Tracked, std::allocator<Tracked>, 4> deque;
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 9; ++i) {
+        deque.push_back(Tracked(i));
+        deque.push_front(Tracked(-i));
+      }
+      while (!deque.empty()) {
+        if (round % 2 == 0) {
+          deque.pop_back();
+        } else {
+          deque.pop_front();
+        }
+      }
+      CHECK(live_elements == 0);
+    }
+    deque.push_back(Tracked(1));
+  }
+  CHECK(live_elements == 0);
+}
+
+// A FIFO keeps walking the live range along the bucket map in one
+// direction, so the map keeps recentring in place; shrink_to_fit must keep
+// the contents whatever state that leaves it in.
+void TestDequeRecentersAndShrinks() {
+  Deque<int, std::allocator<int>, 4> deque;
+  std::deque<int> reference;
+  for (int i = 0; i < 50; ++i) {
+    deque.push_back(i);
+    reference.push_back(i);
+  }
+  for (int direction = 0; direction < 2; ++direction) {
+    for (int round = 0; round < 20000; ++round) {
+      if (direction == 0) {
+        deque.push_back(round);
+        reference.push_back(round);
+        deque.pop_front();
+        reference.pop_front();
+      } else {
+        deque.push_front(round);
+        reference.push_front(round);
+        deque.pop_back();
+        reference.pop_back();
+      }
+      if (round % 5000 == 0) {
+        deque.shrink_to_fit();
+        CheckSame(deque, reference);
+      }
+    }
+    CheckSame(deque, reference);
+    deque.shrink_to_fit();
+    CheckSame(deque, reference);
+  }
+  // Both ends still grow after shrinking to the live buckets.
+  for (int i = 0; i < 100; ++i) {
+    deque.push_front(-i);
+    reference.push_front(-i);
+    deque.push_back(i);
+    reference.push_back(i);
+  }
+  CheckSame(deque, reference);
+  deque.shrink_to_fit();
+  while (!reference.empty()) {
+    deque.pop_back();
+    reference.pop_back();
+  }
+  deque.shrink_to_fit();
+  CHECK(deque.empty());
+  deque.push_front(1);
+  CHECK(deque.size() == 1 && deque[0] == 1);
+}
+
+// Range inserts and erases open or close the gap from the shorter side, so
+// positions near both ends and in the middle take different paths; counts
+// span part of a bucket and several buckets.
+void TestDequeRangeInsertAndErase() {
+  std::mt19937 gen(37);
+  for (size_t count : {1, 3, 17}) {
+    for (int where = 0; where <= 4; ++where) {
+      Deque<std::string, std::allocator<std::string>, 4> deque;
+      std::deque<std::string> reference;
+      for (int i = 0; i < 30; ++i) {
+        deque.push_back(std::to_string(i));
+        reference.push_back(std::to_string(i));
+      }
+      std::vector<std::string> values;
+      for (size_t i = 0; i < count; ++i) {
+        values.push_back(std::to_string(gen() % 100));
+      }
+      auto position = [&] { return reference.size() * where / 4; };
+
+      size_t index = position();
+      auto it = deque.insert(deque.begin() + index, values.begin(),
+                             values.end());
+      reference.insert(reference.begin() + index, values.begin(),
+                       values.end());
+      CHECK(it - deque.begin() == static_cast<std::ptrdiff_t>(index));
+      CheckSame(deque, reference);
+
+      // A single-pass range is buffered first.
+      std::string words;
+      for (const std::string& value : values) {
+        words += value + " ";
+      }
+      std::istringstream stream(words);
+      index = position();
+      deque.insert(deque.begin() + index,
+                   std::istream_iterator<std::string>(stream),
+                   std::istream_iterator<std::string>());
+      reference.insert(reference.begin() + index, values.begin(),
+                       values.end());
+      CheckSame(deque, reference);
+
+      index = position();
+      deque.insert(deque.begin() + index, count, "fill");
+      reference.insert(reference.begin() + index, count, "fill");
+      CheckSame(deque, reference);
+
+      index = std::min(position(), reference.size() - 2 * count);
+      it = deque.erase(deque.begin() + index,
+                       deque.begin() + index + 2 * count);
+      auto reference_it = reference.erase(
+          reference.begin() + index, reference.begin() + index + 2 * count);
+      CHECK(it - deque.begin() == reference_it - reference.begin());
+      CheckSame(deque, reference);
+    }
+  }
+  // Empty ranges are no-ops; std::deque is not used as the reference here
+  // because libstdc++ self-move-assigns elements for an empty insert.
+  Deque<std::string, std::allocator<std::string>, 4> deque(30, "x");
+  std::vector<std::string> none;
+  CHECK(deque.insert(deque.begin() + 7, none.begin(), none.end()) ==
+        deque.begin() + 7);
+  CHECK(deque.insert(deque.begin() + 7, 0, "y") == deque.begin() + 7);
+  CHECK(deque.erase(deque.begin() + 7, deque.begin() + 7) ==
+        deque.begin() + 7);
+  CheckSame(deque, std::deque<std::string>(30, "x"));
+  auto it = deque.erase(deque.begin(), deque.end());
+  CHECK(deque.empty());
+  CHECK(it == deque.end());
+}
+
+// Pushing at both ends leaves the first and last buckets partly filled, so
+// the segments and every subrange split unevenly at the bucket boundaries.
+void TestDequeSegmentsAndSegmentedAlgorithms() {
+  Deque<int, std::allocator<int>, 8> deque;
+  std::deque<int> reference;
+  for (int i = 0; i < 45; ++i) {
+    deque.push_back(i);
+    reference.push_back(i);
+  }
+  for (int i = 1; i <= 5; ++i) {
+    deque.push_front(-i);
+    reference.push_front(-i);
+  }
+
+  std::vector<int> joined;
+  for (size_t i = 0; i < deque.segment_count(); ++i) {
+    std::span<const int> segment = std::as_const(deque).segment(i);
+    CHECK(!segment.empty() && segment.size() <= 8);
+    if (i != 0 && i + 1 != deque.segment_count()) {
+      CHECK(segment.size() == 8);
+    }
+    joined.insert(joined.end(), segment.begin(), segment.end());
+  }
+  CHECK(deque.segment(0).size() < 8);
+  CHECK(deque.segment(deque.segment_count() - 1).size() < 8);
+  CHECK(std::equal(joined.begin(), joined.end(), reference.begin(),
+                   reference.end()));
+
+  for (size_t first = 0; first <= reference.size(); first += 3) {
+    for (size_t last = first; last <= reference.size(); last += 5) {
+      auto begin = deque.cbegin() + first;
+      auto end = deque.cbegin() + last;
+      auto reference_begin = reference.cbegin() + first;
+      auto reference_end = reference.cbegin() + last;
+
+      std::vector<int> visited;
+      segmented::for_each(begin, end,
+                          [&visited](int value) { visited.push_back(value); });
+      CHECK(std::equal(visited.begin(), visited.end(), reference_begin,
+                       reference_end));
+
+      std::vector<int> copied(last - first);
+      CHECK(segmented::copy(begin, end, copied.begin()) == copied.end());
+      CHECK(std::equal(copied.begin(), copied.end(), reference_begin,
+                       reference_end));
+
+      CHECK(segmented::accumulate(begin, end, 0L) ==
+            std::accumulate(reference_begin, reference_end, 0L));
+
+      for (int value : {-5, -1, 0, 7, 8, 23, 39, 44, 100}) {
+        CHECK(segmented::find(begin, end, value) - deque.cbegin() ==
+              std::find(reference_begin, reference_end, value) -
+                  reference.cbegin());
+      }
+    }
+  }
+
+  segmented::fill(deque.begin() + 3, deque.end() - 4, 7);
+  std::fill(reference.begin() + 3, reference.end() - 4, 7);
+  CheckSame(deque, reference);
+}
+
+// Iterators are a bucket map and a position, so every jump is one integer
+// step; walk across bucket boundaries from a partly filled first bucket.
+void TestDequeIteratorArithmetic() {
+  using IntDeque = Deque<int, std::allocator<int>, 4>;
+  static_assert(std::random_access_iterator<IntDeque::iterator>);
+  static_assert(std::random_access_iterator<IntDeque::const_iterator>);
+  static_assert(sizeof(IntDeque::iterator) == 2 * sizeof(void*));
+
+  IntDeque deque;
+  std::deque<int> reference;
+  for (int i = 0; i < 19; ++i) {
+    deque.push_back(i);
+    reference.push_back(i);
+  }
+  for (int i = 1; i <= 3; ++i) {
+    deque.push_front(-i);
+    reference.push_front(-i);
+  }
+  const auto size = static_cast<std::ptrdiff_t>(reference.size());
+  for (std::ptrdiff_t i = 0; i <= size; ++i) {
+    auto it = deque.begin() + i;
+    CHECK(it - deque.begin() == i && deque.end() - it == size - i);
+    CHECK(i + deque.begin() == it && deque.end() - (size - i) == it);
+    for (std::ptrdiff_t j = 0; j <= size; ++j) {
+      auto other = deque.begin() + j;
+      CHECK(other - it == j - i);
+      CHECK(it + (j - i) == other && other - (j - i) == it);
+      CHECK((it < other) == (i < j) && (it > other) == (i > j));
+      CHECK((it <= other) == (i <= j) && (it >= other) == (i >= j));
+      CHECK((it == other) == (i == j) && (it != other) == (i != j));
+      if (j < size) {
+        CHECK(it[j - i] == reference[j]);
+      }
+      auto moved = it;
+      moved += j - i;
+      CHECK(moved == other);
+      moved -= j - i;
+      CHECK(moved == it);
+    }
+  }
+
+  auto forward = deque.cbegin();
+  auto backward = deque.cend();
+  for (std::ptrdiff_t i = 0; i < size; ++i) {
+    CHECK(*forward++ == reference[i]);
+    CHECK(*--backward == reference[size - 1 - i]);
+  }
+  CHECK(forward == deque.cend() && backward == deque.cbegin());
+
+  std::mt19937 gen(41);
+  std::vector<int> values(1000);
+  for (int& value : values) {
+    value = static_cast<int>(gen() % 500);
+  }
+  IntDeque shuffled(values.begin(), values.end());
+  std::sort(shuffled.begin(), shuffled.end());
+  std::sort(values.begin(), values.end());
+  CHECK(std::equal(shuffled.begin(), shuffled.end(), values.begin(),
+                   values.end()));
+  for (int value : {-1, 0, 137, 250, 499, 500}) {
+    CHECK(std::lower_bound(shuffled.begin(), shuffled.end(), value) -
+              shuffled.begin() ==
+          std::lower_bound(values.begin(), values.end(), value) -
+              values.begin());
+  }
+}
+
+struct AllocationStats {
+  int allocations = 0;
+  int deallocations = 0;
+};
+
+// Counts the buckets a Deque allocates; the bucket map is a std::vector and
+// does not go through it.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  explicit CountingAllocator(AllocationStats* stats) : stats(stats) {}
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>& other) : stats(other.stats) {}
+
+  T* allocate(size_t count) {
+    ++stats->allocations;
+    return std::allocator<T>().allocate(count);
+  }
+  void deallocate(T* ptr, size_t count) {
+    ++stats->deallocations;
+    std::allocator<T>().deallocate(ptr, count);
+  }
+  template <typename U>
+  bool operator==(const CountingAllocator<U>& other) const {
+    return stats == other.stats;
+  }
+
+  AllocationStats* stats;
+};
+
+// Queue-like churn empties a bucket at the front for every one filled at the
+// back; with spare buckets kept, it settles without allocating.
+void TestDequeRecyclesSpareBuckets() {
+  AllocationStats stats;
+  {
+    Deque<int, CountingAllocator<int>, 4> deque{CountingAllocator<int>(&stats)};
+    std::deque<int> reference;
+    for (int i = 0; i < 16; ++i) {
+      deque.push_back(i);
+      reference.push_back(i);
+    }
+    auto churn = [&](int rounds) {
+      for (int i = 0; i < rounds; ++i) {
+        deque.push_back(i);
+        reference.push_back(i);
+        deque.pop_front();
+        reference.pop_front();
+      }
+    };
+    churn(8);
+    int settled = stats.allocations;
+    churn(1000);
+    CHECK(stats.allocations == settled);
+    CheckSame(deque, reference);
+
+    deque.set_max_spare_buckets(0);
+    churn(1000);
+    CHECK(stats.allocations >= settled + 1000 / 4 - 1);
+    CheckSame(deque, reference);
+  }
+  CHECK(stats.allocations == stats.deallocations);
+}
+
+// Bulk construction, assign and resize fill whole buckets: each allocates
+// exactly the buckets its final layout needs, with nothing left behind.
+void TestDequeBulkConstructionAndAssign() {
+  using CountingDeque = Deque<int, CountingAllocator<int>, 4>;
+  AllocationStats stats;
+  CountingAllocator<int> alloc(&stats);
+  {
+    CountingDeque filled(50, 7, alloc);
+    CheckSame(filled, std::deque<int>(50, 7));
+    CHECK(stats.allocations == 13);
+
+    CountingDeque zeroes(9, alloc);
+    CheckSame(zeroes, std::deque<int>(9));
+    CHECK(stats.allocations == 13 + 3);
+
+    std::vector<int> values(23);
+    std::iota(values.begin(), values.end(), 0);
+    CountingDeque ranged(values.begin(), values.end(), alloc);
+    CheckSame(ranged, std::deque<int>(values.begin(), values.end()));
+    CHECK(stats.allocations == 16 + 6);
+
+    // The copy mirrors a partly filled first bucket instead of repacking.
+    ranged.push_front(-1);
+    ranged.push_front(-2);
+    int before = stats.allocations;
+    CountingDeque copy(ranged);
+    CHECK(stats.allocations - before ==
+          static_cast<int>(ranged.segment_count()));
+    CHECK(copy.segment(0).size() == ranged.segment(0).size());
+    CheckSame(copy, std::deque<int>(ranged.begin(), ranged.end()));
+
+    before = stats.allocations;
+    CountingDeque moved(std::move(copy));
+    CHECK(stats.allocations == before);
+    CHECK(copy.empty() && copy.segment_count() == 0);
+    CheckSame(moved, std::deque<int>(ranged.begin(), ranged.end()));
+    copy.push_back(1);
+    CheckSame(copy, {1});
+  }
+  CHECK(stats.allocations == stats.deallocations);
+
+  Deque<std::string, std::allocator<std::string>, 4> deque{"a", "b", "c"};
+  std::deque<std::string> reference{"a", "b", "c"};
+  CheckSame(deque, reference);
+  deque.assign(10, "x");
+  reference.assign(10, "x");
+  CheckSame(deque, reference);
+  deque.assign(2, "y");
+  reference.assign(2, "y");
+  CheckSame(deque, reference);
+
+  std::vector<std::string> words{"p", "q", "r", "s", "t", "u", "v"};
+  deque.assign(words.begin(), words.end());
+  reference.assign(words.begin(), words.end());
+  CheckSame(deque, reference);
+  std::istringstream stream("one two three four five six");
+  deque.assign(std::istream_iterator<std::string>(stream),
+               std::istream_iterator<std::string>());
+  reference.assign({"one", "two", "three", "four", "five", "six"});
+  CheckSame(deque, reference);
+  deque.assign({"k"});
+  reference.assign({"k"});
+  CheckSame(deque, reference);
+
+  for (size_t size : {0, 13, 5, 5, 21, 1, 0, 9}) {
+    deque.resize(size);
+    reference.resize(size);
+    CheckSame(deque, reference);
+    deque.resize(size + 3, "z");
+    reference.resize(size + 3, "z");
+    CheckSame(deque, reference);
+  }
+
+  {
+    Deque<Tracked, std::allocator<Tracked>, 4> tracked(11, Tracked(3));
+    CHECK(live_elements == 11);
+    tracked.resize(2, Tracked(0));
+    CHECK(live_elements == 2);
+    tracked.resize(17, Tracked(5));
+    CHECK(live_elements == 17 && tracked[16].value == 5);
+    tracked.assign(6, Tracked(1));
+    CHECK(live_elements == 6);
+  }
+  CHECK(live_elements == 0);
+}
+
+// The owner pushes and pops while thieves steal: every element must come out
+// exactly once.
+void TestWorkStealingDequeHandsOutEachElementOnce() {
+  const int kElements = 200000;
+  const int kThieves = 3;
+  WorkStealingDeque<int, 16> deque;
+  std::vector<std::atomic<int>> seen(kElements);
+  std::atomic<bool> done{false};
+  std::vector<std::thread> thieves;
+  for (int t = 0; t < kThieves; ++t) {
+    thieves.emplace_back([&] {
+      while (!done.load()) {
+        if (auto value = deque.steal()) {
+          seen[*value].fetch_add(1);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < kElements; ++i) {
+    deque.push(i);
+    if (i % 3 == 0) {
+      if (auto value = deque.pop()) {
+        seen[*value].fetch_add(1);
+      }
+    }
+  }
+  while (auto value = deque.pop()) {
+    seen[*value].fetch_add(1);
+  }
+  done.store(true);
+  for (auto& thief : thieves) {
+    thief.join();
+  }
+  while (auto value = deque.steal()) {
+    seen[*value].fetch_add(1);
+  }
+  CHECK(deque.empty());
+  CHECK(std::all_of(seen.begin(), seen.end(),
+                    [](const std::atomic<int>& count) { return count == 1; }));
+}
+
+void TestBlockingQueueSingleThread() {
+  BlockingQueue<int, 4> queue(10);
+  CHECK(queue.capacity() == 10);
+  for (int i = 0; i < 10; ++i) {
+    CHECK(queue.try_push(i));
+  }
+  CHECK(!queue.try_push(10));
+  CHECK(!queue.push_for(10, std::chrono::milliseconds(1)));
+  CHECK(queue.pop() == 0);
+  std::vector<int> out;
+  CHECK(queue.pop_range(std::back_inserter(out), 5) == 5);
+  CHECK((out == std::vector<int>{1, 2, 3, 4, 5}));
+  std::vector<int> more{10, 11, 12};
+  queue.push_range(more.begin(), more.end());
+  CHECK(queue.size() == 7);
+  for (int expected : {6, 7, 8, 9, 10, 11, 12}) {
+    CHECK(queue.try_pop() == expected);
+  }
+  CHECK(!queue.try_pop());
+  CHECK(!queue.pop_for(std::chrono::milliseconds(1)));
+  out.clear();
+  CHECK(queue.pop_range_for(std::back_inserter(out), 5,
+                            std::chrono::milliseconds(1)) == 0);
+}
+
+// A small capacity keeps producers blocking on a full queue and consumers on
+// an empty one.
+void TestBlockingQueueProducersConsumers() {
+  const int kProducers = 4;
+  const int kConsumers = 4;
+  const int kPerProducer = 20000;
+  BlockingQueue<int, 8> queue(32);
+  std::atomic<long long> sum{0};
+  std::atomic<int> popped{0};
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        int value = p * kPerProducer + i;
+        if (i % 2 == 0) {
+          queue.push(value);
+        } else {
+          queue.push_range(&value, &value + 1);
+        }
+      }
+    });
+  }
+  for (int c = 0; c < kConsumers; ++c) {
+    threads.emplace_back([&] {
+      std::vector<int> batch;
+      while (popped.load() < kProducers * kPerProducer) {
+        batch.clear();
+        size_t count = queue.pop_range_for(std::back_inserter(batch), 7,
+                                           std::chrono::milliseconds(5));
+        popped.fetch_add(static_cast<int>(count));
+        sum.fetch_add(std::accumulate(batch.begin(), batch.end(), 0LL));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  long long total = kProducers * kPerProducer;
+  CHECK(popped.load() == total);
+  CHECK(sum.load() == total * (total - 1) / 2);
+  CHECK(queue.empty());
+}
+
+}  // namespace
+
+int main() {
+  TestDequeMatchesStdDeque();
+  TestDequeBucketSizes();
+  TestDequeRecentersAndShrinks();
+  TestDequeRangeInsertAndErase();
+  TestDequeSegmentsAndSegmentedAlgorithms();
+  TestDequeIteratorArithmetic();
+  TestDequeRecyclesSpareBuckets();
+  TestDequeBulkConstructionAndAssign();
+  TestWorkStealingDequeHandsOutEachElementOnce();
+  TestBlockingQueueSingleThread();
+  TestBlockingQueueProducersConsumers();
+}
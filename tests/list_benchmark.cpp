@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "list/list.hpp"
+#include "list/lock_free_list.hpp"
+#include "list/pool_allocator.hpp"
+#include "list/unrolled_list.hpp"
+#include "tests/benchmark.hpp"
+
+namespace {
+
+template <typename List>
+void PushPopRounds(int rounds, int count) {
+  List list;
+  for (int round = 0; round < rounds; ++round) {
+    for (int i = 0; i < count; ++i) {
+      list.push_back(i);
+    }
+    for (int i = 0; i < count; ++i) {
+      list.pop_front();
+    }
+  }
+  benchmark_sink = benchmark_sink + list.size();
+}
+
+void BenchmarkPoolAllocator() {
+  Measure("List, std::allocator, 20 x 100k push_back/pop_front",
+          [] { PushPopRounds<List<int>>(20, 100'000); });
+  Measure("List, PoolAllocator, 20 x 100k push_back/pop_front",
+          [] { PushPopRounds<List<int, PoolAllocator<int>>>(20, 100'000); });
+}
+
+template <typename Container>
+void Traverse(const Container& container, int passes) {
+  uint64_t sum = 0;
+  for (int pass = 0; pass < passes; ++pass) {
+    for (int value : container) {
+      sum += value;
+    }
+  }
+  benchmark_sink = sum;
+}
+
+// Inserts before a fixed element in the middle, as an editor would.
+template <typename Container>
+void InsertNearIterator(Container& container, int count) {
+  auto it = std::next(container.begin(), container.size() / 2);
+  for (int i = 0; i < count; ++i) {
+    it = container.insert(it, i);
+  }
+  benchmark_sink = benchmark_sink + container.size();
+}
+
+void BenchmarkUnrolledList() {
+  const int kSize = 2'000'000;
+  List<int> list;
+  UnrolledList<int> unrolled;
+  for (int i = 0; i < kSize; ++i) {
+    list.push_back(i);
+    unrolled.push_back(i);
+  }
+  Measure("List, 10 passes over 2M", [&] { Traverse(list, 10); });
+  Measure("UnrolledList, 10 passes over 2M", [&] { Traverse(unrolled, 10); });
+  Measure("List, 500k inserts near an iterator",
+          [&] { InsertNearIterator(list, 500'000); }, 1);
+  Measure("UnrolledList, 500k inserts near an iterator",
+          [&] { InsertNearIterator(unrolled, 500'000); }, 1);
+}
+
+// Sorting relinks the nodes without moving them, which leaves a traversal
+// jumping around the heap until compact() lays them out in order.
+template <typename Allocator>
+void BenchmarkCompact(const std::string& label) {
+  std::mt19937 gen(48);
+  List<int, Allocator> list;
+  for (int i = 0; i < 1'000'000; ++i) {
+    list.push_back(static_cast<int>(gen()));
+  }
+  list.sort();
+  Measure(label + ", 10 passes over 1M after sort",
+          [&] { Traverse(list, 10); });
+  Measure(label + ", compact", [&] { list.compact(); }, 1);
+  Measure(label + ", 10 passes over 1M after compact",
+          [&] { Traverse(list, 10); });
+}
+
+// An ordered set on a sorted List behind one mutex, the baseline the
+// lock-free list replaces.
+class MutexSet {
+ public:
+  bool insert(int value) {
+    std::lock_guard lock(mutex_);
+    auto it = lower_bound(value);
+    if (it != list_.end() && *it == value) {
+      return false;
+    }
+    list_.insert(it, value);
+    return true;
+  }
+  bool erase(int value) {
+    std::lock_guard lock(mutex_);
+    auto it = lower_bound(value);
+    if (it == list_.end() || *it != value) {
+      return false;
+    }
+    list_.erase(it);
+    return true;
+  }
+  bool contains(int value) {
+    std::lock_guard lock(mutex_);
+    auto it = lower_bound(value);
+    return it != list_.end() && *it == value;
+  }
+
+ private:
+  List<int>::iterator lower_bound(int value) {
+    return std::find_if(list_.begin(), list_.end(),
+                        [value](int element) { return element >= value; });
+  }
+
+  std::mutex mutex_;
+  List<int> list_;
+};
+
+// Every thread runs the same number of operations, one in five a write.
+template <typename Set>
+void MixedWorkload(Set& set, int threads, int operations) {
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&set, t, operations] {
+      std::mt19937 gen(t);
+      uint64_t hits = 0;
+      for (int i = 0; i < operations; ++i) {
+        int value = static_cast<int>(gen() % 1000);
+        switch (gen() % 10) {
+          case 0:
+            hits += set.insert(value);
+            break;
+          case 1:
+            hits += set.erase(value);
+            break;
+          default:
+            hits += set.contains(value);
+        }
+      }
+      benchmark_sink = benchmark_sink + hits;
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void BenchmarkLockFreeList() {
+  const int kOperations = 200'000;
+  int cores =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  for (int threads = 1; threads <= std::max(8, cores); threads *= 2) {
+    std::string label = std::to_string(threads) + " threads";
+    LockFreeList<int> lock_free;
+    MutexSet guarded;
+    for (int i = 0; i < 1000; i += 2) {
+      lock_free.insert(i);
+      guarded.insert(i);
+    }
+    Measure("LockFreeList, " + label,
+            [&] { MixedWorkload(lock_free, threads, kOperations); }, 1);
+    Measure("mutex-guarded List, " + label,
+            [&] { MixedWorkload(guarded, threads, kOperations); }, 1);
+  }
+}
+
+}  // namespace
+
+int main() {
+  Section("Pooled nodes");
+  BenchmarkPoolAllocator();
+
+  Section("Unrolled list");
+  BenchmarkUnrolledList();
+
+  Section("Compacting a scattered list");
+  BenchmarkCompact<std::allocator<int>>("std::allocator");
+  BenchmarkCompact<PoolAllocator<int>>("PoolAllocator");
+
+  Section("Mixed reads and writes, 20% writes");
+  BenchmarkLockFreeList();
+}
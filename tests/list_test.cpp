@@ -0,0 +1,612 @@
+#include <atomic>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "list/intrusive_list.hpp"
+#include "list/list.hpp"
+#include "list/lock_free_list.hpp"
+#include "list/pool_allocator.hpp"
+#include "list/unrolled_list.hpp"
+#include "tests/check.hpp"
+
+namespace {
+
+template <typename List, typename Reference>
+void CheckSame(const List& list, const Reference& reference) {
+  CHECK(list.size() == reference.size());
+  CHECK(std::equal(list.begin(), list.end(), reference.begin(),
+                   reference.end()));
+}
+
+void TestListMatchesStdList() {
+  std::mt19937 gen(44);
+  List<std::string, PoolAllocator<std::string>> list;
+  std::list<std::string> reference;
+  for (int op = 0; op < 5000; ++op) {
+    std::string value = std::to_string(gen() % 100);
+    size_t position = reference.empty() ? 0 : gen() % (reference.size() + 1);
+    auto it = std::next(list.begin(), position);
+    auto reference_it = std::next(reference.begin(), position);
+    switch (gen() % 5) {
+      case 0:
+      case 1:
+        list.insert(it, value);
+        reference.insert(reference_it, value);
+        break;
+      case 2:
+        if (position < reference.size()) {
+          list.erase(it);
+          reference.erase(reference_it);
+        }
+        break;
+      case 3:
+        list.emplace_front(value);
+        reference.emplace_front(value);
+        break;
+      case 4:
+        if (gen() % 50 == 0) {
+          list.sort();
+          reference.sort();
+          list.unique();
+          reference.unique();
+          list.compact();
+        }
+        break;
+    }
+  }
+  CheckSame(list, reference);
+  list.reverse();
+  reference.reverse();
+  CheckSame(list, reference);
+}
+
+// Picks indices first <= last <= size and a position outside [first, last),
+// as a self-splice of a range requires.
+struct SpliceRange {
+  size_t first;
+  size_t last;
+  size_t position;
+};
+
+SpliceRange RandomSpliceRange(std::mt19937& gen, size_t size,
+                              size_t target_size, bool self) {
+  size_t first = gen() % (size + 1);
+  size_t last = first + gen() % (size - first + 1);
+  size_t position = gen() % (target_size + 1);
+  if (self && position >= first && position < last) {
+    position = first > 0 && gen() % 2 == 0 ? first - 1 : last;
+  }
+  return {first, last, position};
+}
+
+void TestListSpliceAndMergeMatchStdList() {
+  std::mt19937 gen(44);
+  using Pooled = List<int, PoolAllocator<int>>;
+  Pooled lists[2];
+  std::list<int> references[2];
+  for (int op = 0; op < 4000; ++op) {
+    size_t to = gen() % 2;
+    size_t from = gen() % 2;
+    Pooled& list = lists[to];
+    Pooled& other = lists[from];
+    std::list<int>& reference = references[to];
+    std::list<int>& other_reference = references[from];
+    switch (gen() % 6) {
+      case 0:
+      case 1: {
+        int value = static_cast<int>(gen() % 100);
+        size_t position = gen() % (reference.size() + 1);
+        list.insert(std::next(list.begin(), position), value);
+        reference.insert(std::next(reference.begin(), position), value);
+        break;
+      }
+      case 2:
+        // Splicing a whole list into itself is not allowed.
+        if (to != from && gen() % 8 == 0) {
+          size_t position = gen() % (reference.size() + 1);
+          list.splice(std::next(list.begin(), position), other);
+          reference.splice(std::next(reference.begin(), position),
+                           other_reference);
+        }
+        break;
+      case 3:
+        if (!other_reference.empty()) {
+          size_t it = gen() % other_reference.size();
+          size_t position = gen() % (reference.size() + 1);
+          list.splice(std::next(list.begin(), position), other,
+                      std::next(other.begin(), it));
+          reference.splice(std::next(reference.begin(), position),
+                           other_reference,
+                           std::next(other_reference.begin(), it));
+        }
+        break;
+      case 4: {
+        SpliceRange range = RandomSpliceRange(gen, other_reference.size(),
+                                              reference.size(), to == from);
+        list.splice(std::next(list.begin(), range.position), other,
+                    std::next(other.begin(), range.first),
+                    std::next(other.begin(), range.last));
+        reference.splice(std::next(reference.begin(), range.position),
+                         other_reference,
+                         std::next(other_reference.begin(), range.first),
+                         std::next(other_reference.begin(), range.last));
+        break;
+      }
+      case 5:
+        if (gen() % 10 == 0) {
+          // Descending order through a comparator; merge keeps this list's
+          // elements ahead of equal ones from other.
+          list.sort(std::greater<>());
+          other.sort(std::greater<>());
+          reference.sort(std::greater<>());
+          other_reference.sort(std::greater<>());
+          list.merge(other, std::greater<>());
+          reference.merge(other_reference, std::greater<>());
+        }
+        break;
+    }
+    CHECK(list.size() == reference.size());
+    CHECK(other.size() == other_reference.size());
+  }
+  CheckSame(lists[0], references[0]);
+  CheckSame(lists[1], references[1]);
+  for (int i = 0; i < 2; ++i) {
+    lists[i].sort();
+    references[i].sort();
+  }
+  lists[0].merge(std::move(lists[1]));
+  references[0].merge(std::move(references[1]));
+  CheckSame(lists[0], references[0]);
+  CHECK(lists[1].empty());
+}
+
+// Default pooled lists share the thread's pool, so nodes handed from one to
+// the other outlive the list that allocated them.
+void TestPoolAllocatorDefaultsShareAPool() {
+  CHECK(PoolAllocator<int>() == PoolAllocator<double>());
+  CHECK(!(PoolAllocator<int>() ==
+          PoolAllocator<int>(std::make_shared<NodePool>())));
+  List<int, PoolAllocator<int>> list;
+  {
+    List<int, PoolAllocator<int>> other(3, 7);
+    CHECK(list.get_allocator() == other.get_allocator());
+    list.splice(list.end(), other);
+  }
+  {
+    List<int, PoolAllocator<int>> other{1, 2};
+    list.merge(other);
+  }
+  CheckSame(list, std::list<int>{1, 2, 7, 7, 7});
+  {
+    List<int, PoolAllocator<int>> other{9};
+    list = std::move(other);
+    list.push_back(10);
+  }
+  CheckSame(list, std::list<int>{9, 10});
+}
+
+struct Arena {
+  int live_nodes = 0;
+};
+
+// Unlike PoolAllocator it stays with the list on move assignment, so moving
+// between lists of different arenas has to move the values one by one.
+template <typename T>
+struct ArenaAllocator {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::false_type;
+
+  explicit ArenaAllocator(Arena* arena) : arena(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(size_t count) {
+    ++arena->live_nodes;
+    return std::allocator<T>().allocate(count);
+  }
+  void deallocate(T* ptr, size_t count) {
+    --arena->live_nodes;
+    std::allocator<T>().deallocate(ptr, count);
+  }
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena == other.arena;
+  }
+
+  Arena* arena;
+};
+
+template <typename List>
+void FillPointers(List& list, int count) {
+  for (int i = 0; i < count; ++i) {
+    auto value = std::make_unique<int>(i);
+    if (i % 2 == 0) {
+      list.push_back(std::move(value));
+    } else {
+      list.push_front(std::move(value));
+    }
+    CHECK(value == nullptr);
+  }
+}
+
+template <typename List>
+std::vector<int> Values(const List& list) {
+  std::vector<int> values;
+  for (const auto& value : list) {
+    values.push_back(value ? *value : -1);
+  }
+  return values;
+}
+
+// Move-only values show that nothing is copied: moves steal the nodes where
+// the allocators allow it and move the values one by one where they do not.
+void TestListMoves() {
+  using Pointer = std::unique_ptr<int>;
+  const std::vector<int> expected{5, 3, 1, 0, 2, 4};
+
+  List<Pointer> list;
+  FillPointers(list, 6);
+  CHECK(Values(list) == expected);
+  const Pointer* front = &list.front();
+  List<Pointer> moved(std::move(list));
+  CHECK(list.empty() && &moved.front() == front);
+  CHECK(Values(moved) == expected);
+  FillPointers(list, 1);
+  list = std::move(moved);
+  CHECK(moved.empty() && &list.front() == front);
+  CHECK(Values(list) == expected);
+
+  // PoolAllocator propagates, so the target adopts the pool with the nodes.
+  auto pool = std::make_shared<NodePool>();
+  List<Pointer, PoolAllocator<Pointer>> pooled{PoolAllocator<Pointer>(pool)};
+  List<Pointer, PoolAllocator<Pointer>> other{
+      PoolAllocator<Pointer>(std::make_shared<NodePool>())};
+  FillPointers(pooled, 6);
+  FillPointers(other, 2);
+  front = &pooled.front();
+  other = std::move(pooled);
+  CHECK(pooled.empty() && &other.front() == front);
+  CHECK(other.get_allocator() == PoolAllocator<Pointer>(pool));
+  CHECK(Values(other) == expected);
+
+  Arena first_arena;
+  Arena second_arena;
+  {
+    using ArenaList = List<Pointer, ArenaAllocator<Pointer>>;
+    ArenaList first{ArenaAllocator<Pointer>(&first_arena)};
+    ArenaList second{ArenaAllocator<Pointer>(&second_arena)};
+    FillPointers(first, 6);
+    FillPointers(second, 2);
+    second = std::move(first);
+    CHECK(second.get_allocator() == ArenaAllocator<Pointer>(&second_arena));
+    CHECK(Values(second) == expected);
+    CHECK(Values(first) == std::vector<int>(6, -1));
+    CHECK(first_arena.live_nodes == 6 && second_arena.live_nodes == 6);
+
+    ArenaList third{ArenaAllocator<Pointer>(&second_arena)};
+    front = &second.front();
+    third = std::move(second);
+    CHECK(second.empty() && &third.front() == front);
+    CHECK(second_arena.live_nodes == 6);
+  }
+  CHECK(first_arena.live_nodes == 0 && second_arena.live_nodes == 0);
+}
+
+// A node capacity of 4 makes nearly every insertion split and every erasure
+// merge.
+void TestUnrolledListMatchesStdList() {
+  std::mt19937 gen(46);
+  UnrolledList<std::string, std::allocator<std::string>, 4> list;
+  std::list<std::string> reference;
+  for (int op = 0; op < 20000; ++op) {
+    std::string value = std::to_string(gen() % 100);
+    size_t position = reference.empty() ? 0 : gen() % (reference.size() + 1);
+    auto it = std::next(list.begin(), position);
+    auto reference_it = std::next(reference.begin(), position);
+    switch (gen() % 6) {
+      case 0:
+      case 1:
+        CHECK(*list.insert(it, value) == value);
+        reference.insert(reference_it, value);
+        break;
+      case 2:
+      case 3:
+        if (position < reference.size()) {
+          auto next = list.erase(it);
+          auto reference_next = reference.erase(reference_it);
+          CHECK((next == list.end()) == (reference_next == reference.end()));
+          CHECK(next == list.end() || *next == *reference_next);
+        }
+        break;
+      case 4:
+        list.push_front(value);
+        reference.push_front(value);
+        break;
+      case 5:
+        if (!reference.empty()) {
+          list.pop_back();
+          reference.pop_back();
+        }
+        break;
+    }
+  }
+  CheckSame(list, reference);
+  CHECK(list.node_count() * 4 >= list.size());
+  list.clear();
+  CHECK(list.empty() && list.node_count() == 0);
+}
+
+int alive = 0;
+int moves_left = -1;
+
+// Throws from the move that finds moves_left at zero.
+struct ThrowingMove {
+  explicit ThrowingMove(int value) : value(value) { ++alive; }
+  ThrowingMove(const ThrowingMove& other) : value(other.value) { ++alive; }
+  ThrowingMove(ThrowingMove&& other) : value(other.value) {
+    count_move();
+    ++alive;
+  }
+  ThrowingMove& operator=(const ThrowingMove& other) = default;
+  ThrowingMove& operator=(ThrowingMove&& other) {
+    count_move();
+    value = other.value;
+    return *this;
+  }
+  ~ThrowingMove() { --alive; }
+
+  static void count_move() {
+    if (moves_left >= 0 && moves_left-- == 0) {
+      throw std::runtime_error("move");
+    }
+  }
+
+  int value;
+};
+
+// Splits and merges that throw halfway must leave size() equal to the number
+// of elements reachable by iteration, and destroy each element exactly once.
+void TestUnrolledListThrowingMoves() {
+  for (int throw_at = 0; throw_at < 400; throw_at += 3) {
+    {
+      std::mt19937 gen(46);
+      UnrolledList<ThrowingMove, std::allocator<ThrowingMove>, 8> list;
+      for (int i = 0; i < 64; ++i) {
+        list.push_back(ThrowingMove(i));
+      }
+      moves_left = throw_at;
+      try {
+        // Mostly erasing thins the nodes out until they start merging.
+        for (int i = 0; i < 60; ++i) {
+          size_t position = gen() % list.size();
+          if (gen() % 3 == 0) {
+            list.insert(std::next(list.begin(), position), ThrowingMove(-i));
+          } else {
+            list.erase(std::next(list.begin(), position));
+          }
+        }
+      } catch (const std::runtime_error&) {
+      }
+      moves_left = -1;
+      auto distance = std::distance(list.begin(), list.end());
+      CHECK(static_cast<size_t>(distance) == list.size());
+      CHECK(alive == distance);
+      // The list must stay usable after the failure.
+      list.erase(list.begin(), std::next(list.begin(), distance / 2));
+      list.push_front(ThrowingMove(0));
+      CHECK(static_cast<size_t>(std::distance(list.begin(), list.end())) ==
+            list.size());
+    }
+    CHECK(alive == 0);
+  }
+}
+
+// The hooks sit after other members so that a wrong offset is noticed.
+struct Entry {
+  explicit Entry(int key) : key(key) {}
+
+  int key;
+  std::string name = "entry";
+  ListHook lru_hook;
+  ListHook bucket_hook;
+};
+
+template <typename List>
+std::vector<int> Keys(const List& list) {
+  std::vector<int> keys;
+  for (const Entry& entry : list) {
+    keys.push_back(entry.key);
+  }
+  return keys;
+}
+
+void TestIntrusiveListWithTwoHooks() {
+  std::vector<Entry> entries;
+  for (int key = 0; key < 6; ++key) {
+    entries.emplace_back(key);
+  }
+  IntrusiveList<Entry, &Entry::lru_hook> lru;
+  IntrusiveList<Entry, &Entry::bucket_hook> odd;
+  for (Entry& entry : entries) {
+    lru.push_back(entry);
+    if (entry.key % 2 == 1) {
+      odd.push_front(entry);
+    }
+  }
+  CHECK((Keys(lru) == std::vector<int>{0, 1, 2, 3, 4, 5}));
+  CHECK((Keys(odd) == std::vector<int>{5, 3, 1}));
+  CHECK(&lru.front() == &entries[0] && &odd.back() == &entries[1]);
+  CHECK(odd.begin()->name == "entry");
+
+  lru.move_to(lru.begin(), entries[4]);
+  lru.erase(lru.iterator_to(entries[2]));
+  entries[3].lru_hook.unlink();
+  CHECK((Keys(lru) == std::vector<int>{4, 0, 1, 5}));
+  CHECK(lru.size() == 4 && !entries[2].lru_hook.is_linked());
+  CHECK(odd.size() == 3);
+
+  IntrusiveList<Entry, &Entry::lru_hook> other;
+  other.push_back(entries[2]);
+  lru.swap(other);
+  CHECK((Keys(lru) == std::vector<int>{2}));
+  CHECK((Keys(other) == std::vector<int>{4, 0, 1, 5}));
+  other.move_to(other.end(), entries[2]);
+  CHECK(lru.empty() && other.back().key == 2);
+  other.clear();
+  CHECK(!entries[0].lru_hook.is_linked() && odd.front().key == 5);
+}
+
+template <typename T>
+std::vector<T> Elements(const LockFreeList<T>& list) {
+  std::vector<T> elements;
+  list.for_each([&](const T& value) { elements.push_back(value); });
+  return elements;
+}
+
+void TestLockFreeListMatchesStdSet() {
+  std::mt19937 gen(49);
+  LockFreeList<int> list;
+  std::set<int> reference;
+  for (int op = 0; op < 20000; ++op) {
+    int value = static_cast<int>(gen() % 500);
+    switch (gen() % 3) {
+      case 0:
+        CHECK(list.insert(value) == reference.insert(value).second);
+        break;
+      case 1:
+        CHECK(list.erase(value) == (reference.erase(value) == 1));
+        break;
+      case 2:
+        CHECK(list.contains(value) == (reference.count(value) == 1));
+        break;
+    }
+  }
+  CHECK(list.size() == reference.size());
+  CHECK(Elements(list) == std::vector<int>(reference.begin(), reference.end()));
+}
+
+std::atomic<int> live_keys{0};
+
+struct CountedKey {
+  CountedKey(int key) : key(key) { ++live_keys; }
+  CountedKey(const CountedKey& other) : key(other.key) { ++live_keys; }
+  ~CountedKey() { --live_keys; }
+
+  bool operator<(const CountedKey& other) const { return key < other.key; }
+
+  int key;
+};
+
+// Compares like CountedKey but throws on a chosen key, as a comparator that
+// allocates or locks might.
+struct ThrowingLess {
+  bool operator()(const CountedKey& lhs, const CountedKey& rhs) const {
+    if (lhs.key == throw_on || rhs.key == throw_on) {
+      throw std::runtime_error("comparison failed");
+    }
+    return lhs < rhs;
+  }
+
+  int throw_on;
+};
+
+// A node whose insertion fails inside the search is freed, not leaked.
+void TestLockFreeListThrowingComparator() {
+  {
+    LockFreeList<CountedKey, ThrowingLess> list(ThrowingLess{13});
+    for (int key = 0; key < 10; ++key) {
+      list.insert(key);
+    }
+    bool threw = false;
+    try {
+      list.emplace(13);
+    } catch (const std::runtime_error&) {
+      threw = true;
+    }
+    CHECK(threw && list.size() == 10);
+    CHECK(live_keys.load() == 10);
+  }
+  CHECK(live_keys.load() == 0);
+}
+
+// Writers fight over the same keys while readers traverse. Every thread ends
+// having erased its own odd keys, so exactly the even keys remain, and the
+// erased nodes must be freed once the threads are gone.
+void TestLockFreeListConcurrentWriters() {
+  const int kThreads = 4;
+  const int kKeys = 2000;
+  {
+    LockFreeList<CountedKey> list;
+    std::atomic<int> writers_done{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int round = 0; round < 3; ++round) {
+          for (int key = 0; key < kKeys; ++key) {
+            list.insert(key);
+            if (key % 2 == 1 && key % kThreads == t) {
+              list.erase(key - 1);
+              list.insert(key - 1);
+            }
+          }
+          for (int key = 1; key < kKeys; key += 2) {
+            list.erase(key);
+          }
+        }
+        writers_done.fetch_add(1);
+      });
+    }
+    for (int t = 0; t < 2; ++t) {
+      threads.emplace_back([&] {
+        while (writers_done.load() < kThreads) {
+          int previous = -1;
+          list.for_each([&](const CountedKey& value) {
+            CHECK(value.key > previous);
+            previous = value.key;
+          });
+          list.contains(kKeys / 2);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    std::vector<CountedKey> elements = Elements(list);
+    CHECK(elements.size() == kKeys / 2 && list.size() == kKeys / 2);
+    for (int i = 0; i < kKeys / 2; ++i) {
+      CHECK(elements[i].key == 2 * i);
+    }
+    elements.clear();
+    // A few more operations on one thread reclaim what the idle records of
+    // the finished threads still hold.
+    for (int i = 0; i < 300; ++i) {
+      list.insert(-1 - i);
+      list.erase(-1 - i);
+    }
+    CHECK(live_keys.load() <= kKeys / 2 + 128);
+  }
+  CHECK(live_keys.load() == 0);
+}
+
+}  // namespace
+
+int main() {
+  TestListMatchesStdList();
+  TestPoolAllocatorDefaultsShareAPool();
+  TestListMoves();
+  TestListSpliceAndMergeMatchStdList();
+  TestUnrolledListMatchesStdList();
+  TestUnrolledListThrowingMoves();
+  TestIntrusiveListWithTwoHooks();
+  TestLockFreeListMatchesStdSet();
+  TestLockFreeListThrowingComparator();
+  TestLockFreeListConcurrentWriters();
+}
@@ -0,0 +1,226 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "matrix/matrix.hpp"
+#include "matrix/matrix_batch.hpp"
+#include "matrix/matrix_file.hpp"
+#include "matrix/sparse_matrix.hpp"
+#include "tests/benchmark.hpp"
+
+namespace {
+
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> RandomMatrix(std::mt19937& gen, double density = 1) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  Matrix<N, M, T> matrix;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      if (unit(gen) < density) {
+        matrix(i, j) = static_cast<T>(unit(gen) * 2 - 1);
+      }
+    }
+  }
+  return matrix;
+}
+
+template <size_t N, size_t M, typename T>
+void Consume(const Matrix<N, M, T>& matrix) {
+  benchmark_sink =
+      benchmark_sink + static_cast<uint64_t>(std::abs(matrix(0, 0)) * 1000);
+}
+
+// The crossover is the smallest size at which a Strassen policy beats the
+// blocked kernel; the cutoff is where the recursion hands over to it.
+template <size_t N>
+void BenchmarkStrassen(std::mt19937& gen) {
+  auto lhs = RandomMatrix<N, N, double>(gen);
+  auto rhs = RandomMatrix<N, N, double>(gen);
+  std::string size = std::to_string(N);
+  Measure("blocked " + size, [&] {
+    Consume(lhs.template Multiply<BlockedMultiplication>(rhs));
+  });
+  Measure("strassen " + size + ", cutoff 32", [&] {
+    Consume(lhs.template Multiply<StrassenMultiplication<32>>(rhs));
+  });
+  Measure("strassen " + size + ", cutoff 64", [&] {
+    Consume(lhs.template Multiply<StrassenMultiplication<64>>(rhs));
+  });
+  Measure("strassen " + size + ", cutoff 128", [&] {
+    Consume(lhs.template Multiply<StrassenMultiplication<128>>(rhs));
+  });
+}
+
+template <size_t N>
+void BenchmarkSparse(std::mt19937& gen, double density) {
+  auto dense = RandomMatrix<N, N, double>(gen, density);
+  auto vector = RandomMatrix<N, 1, double>(gen);
+  CsrMatrix<N, N, double> csr(dense);
+  CscMatrix<N, N, double> csc(dense);
+  std::string label = std::to_string(static_cast<int>(density * 100)) + "%";
+  size_t sparse_bytes = csr.NonZeros() * (sizeof(double) + sizeof(size_t)) +
+                        (N + 1) * sizeof(size_t);
+  std::cout << "density " << label << ": " << sparse_bytes / 1024
+            << " KiB sparse, " << N * N * sizeof(double) / 1024
+            << " KiB dense" << std::endl;
+  Measure("dense matrix * vector, " + label,
+          [&] { Consume(dense * vector); });
+  Measure("csr * vector, " + label, [&] { Consume(csr * vector); });
+  Measure("csc * vector, " + label, [&] { Consume(csc * vector); });
+}
+
+// Gaussian elimination with partial pivoting on nested vectors, the way
+// systems were solved before LuDecomposition.
+template <size_t N>
+std::vector<double> NaiveSolve(std::vector<std::vector<double>> matrix,
+                               std::vector<double> rhs) {
+  for (size_t k = 0; k < N; ++k) {
+    size_t pivot = k;
+    for (size_t i = k + 1; i < N; ++i) {
+      if (std::abs(matrix[i][k]) > std::abs(matrix[pivot][k])) {
+        pivot = i;
+      }
+    }
+    std::swap(matrix[k], matrix[pivot]);
+    std::swap(rhs[k], rhs[pivot]);
+    for (size_t i = k + 1; i < N; ++i) {
+      double factor = matrix[i][k] / matrix[k][k];
+      for (size_t j = k; j < N; ++j) {
+        matrix[i][j] -= factor * matrix[k][j];
+      }
+      rhs[i] -= factor * rhs[k];
+    }
+  }
+  for (size_t i = N; i-- > 0;) {
+    for (size_t j = i + 1; j < N; ++j) {
+      rhs[i] -= matrix[i][j] * rhs[j];
+    }
+    rhs[i] /= matrix[i][i];
+  }
+  return rhs;
+}
+
+template <size_t N>
+void BenchmarkSolve(std::mt19937& gen) {
+  auto matrix = RandomMatrix<N, N, double>(gen);
+  auto rhs = RandomMatrix<N, 1, double>(gen);
+  std::vector<std::vector<double>> nested(N, std::vector<double>(N));
+  std::vector<double> flat_rhs(N);
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      nested[i][j] = matrix(i, j);
+    }
+    flat_rhs[i] = rhs(i, 0);
+  }
+  std::string size = std::to_string(N);
+  Measure("naive gaussian elimination " + size, [&] {
+    double first = NaiveSolve<N>(nested, flat_rhs)[0];
+    benchmark_sink = benchmark_sink + static_cast<uint64_t>(std::abs(first));
+  });
+  Measure("Solve " + size, [&] { Consume(Solve(matrix, rhs)); });
+  Measure("Determinant " + size, [&] {
+    double determinant = matrix.Determinant();
+    benchmark_sink = benchmark_sink + (determinant == 0);
+  });
+}
+
+// Startup cost of a matrix kept on disk: parsing text into nested vectors
+// against loading or mapping the binary format.
+template <size_t N>
+void BenchmarkStartup(std::mt19937& gen) {
+  auto matrix = RandomMatrix<N, N, double>(gen);
+  auto directory = std::filesystem::temp_directory_path();
+  std::string text_path = (directory / "matrix_benchmark.txt").string();
+  std::string binary_path = (directory / "matrix_benchmark.bin").string();
+  {
+    std::ofstream text(text_path);
+    for (size_t i = 0; i < N; ++i) {
+      for (size_t j = 0; j < N; ++j) {
+        text << matrix(i, j) << (j + 1 == N ? '\n' : ' ');
+      }
+    }
+  }
+  SaveBinary(matrix, binary_path);
+  std::cout << "file of " << N * N * sizeof(double) / (1024 * 1024)
+            << " MiB" << std::endl;
+
+  Measure("parse text", [&] {
+    std::ifstream text(text_path);
+    std::vector<std::vector<double>> rows(N, std::vector<double>(N));
+    for (auto& row : rows) {
+      for (double& value : row) {
+        text >> value;
+      }
+    }
+    Consume(Matrix<N, N, double>(rows));
+  }, 1);
+  Measure("LoadBinary",
+          [&] { Consume(LoadBinary<N, N, double>(binary_path)); });
+  Measure("MappedMatrix, touching every page", [&] {
+    MappedMatrix<N, N, double> mapped(binary_path);
+    double sum = 0;
+    for (size_t i = 0; i < N * N; i += 4096 / sizeof(double)) {
+      sum += mapped.Data()[i];
+    }
+    benchmark_sink = benchmark_sink + static_cast<uint64_t>(std::abs(sum));
+  });
+  Measure("SaveBinary", [&] { SaveBinary(matrix, binary_path); });
+  std::filesystem::remove(text_path);
+  std::filesystem::remove(binary_path);
+}
+
+void BenchmarkBatch(std::mt19937& gen) {
+  const size_t kCount = 1 << 20;
+  std::vector<Matrix<4, 4, float>> lhs;
+  std::vector<Matrix<4, 4, float>> rhs;
+  MatrixBatch<4, 4, float> lhs_batch(kCount);
+  MatrixBatch<4, 4, float> rhs_batch(kCount);
+  for (size_t i = 0; i < kCount; ++i) {
+    lhs.push_back(RandomMatrix<4, 4, float>(gen));
+    rhs.push_back(RandomMatrix<4, 4, float>(gen));
+    lhs_batch.Set(i, lhs.back());
+    rhs_batch.Set(i, rhs.back());
+  }
+  std::vector<Matrix<4, 4, float>> products(kCount);
+  Measure("1M Matrix<4, 4, float> products, one by one", [&] {
+    for (size_t i = 0; i < kCount; ++i) {
+      products[i] = lhs[i] * rhs[i];
+    }
+    Consume(products[kCount / 2]);
+  });
+  Measure("1M Matrix<4, 4, float> products, MatrixBatch", [&] {
+    Consume((lhs_batch * rhs_batch).Get(kCount / 2));
+  });
+}
+
+}  // namespace
+
+int main() {
+  std::mt19937 gen(26);
+  Section("Strassen against the blocked kernel");
+  BenchmarkStrassen<128>(gen);
+  BenchmarkStrassen<256>(gen);
+  BenchmarkStrassen<512>(gen);
+  BenchmarkStrassen<1024>(gen);
+
+  Section("Sparse matrix * vector, 2000 x 2000");
+  for (double density : {0.01, 0.05, 0.2}) {
+    BenchmarkSparse<2000>(gen, density);
+  }
+
+  Section("Solving a linear system");
+  BenchmarkSolve<200>(gen);
+  BenchmarkSolve<500>(gen);
+
+  Section("Loading a matrix from disk");
+  BenchmarkStartup<2048>(gen);
+
+  Section("Batched small products");
+  BenchmarkBatch(gen);
+}
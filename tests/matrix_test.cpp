@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "matrix/matrix.hpp"
+#include "matrix/matrix_batch.hpp"
+#include "matrix/matrix_file.hpp"
+#include "matrix/modular.hpp"
+#include "matrix/sparse_matrix.hpp"
+#include "tests/check.hpp"
+
+namespace {
+
+template <size_t N, size_t M, typename T>
+Matrix<N, M, T> RandomMatrix(std::mt19937& gen, T low, T high) {
+  Matrix<N, M, T> matrix;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      if constexpr (std::is_floating_point_v<T>) {
+        matrix(i, j) = std::uniform_real_distribution<T>(low, high)(gen);
+      } else {
+        matrix(i, j) = std::uniform_int_distribution<T>(low, high)(gen);
+      }
+    }
+  }
+  return matrix;
+}
+
+template <size_t N, size_t M, typename T>
+T MaxAbs(const Matrix<N, M, T>& matrix) {
+  T answer{};
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      answer = std::max(answer, std::abs(matrix(i, j)));
+    }
+  }
+  return answer;
+}
+
+// Strassen reorders the additions, so it may only differ from the blocked
+// kernel by rounding: the error bound grows with N and the operand sizes.
+template <size_t N, size_t Cutoff, typename T>
+void CheckStrassenAccuracy(std::mt19937& gen, T tolerance) {
+  auto lhs = RandomMatrix<N, N, T>(gen, T(-1), T(1));
+  auto rhs = RandomMatrix<N, N, T>(gen, T(-1), T(1));
+  Matrix<N, N, T> blocked = lhs * rhs;
+  Matrix<N, N, T> strassen =
+      lhs.template Multiply<StrassenMultiplication<Cutoff>>(rhs);
+  T scale = MaxAbs(lhs) * MaxAbs(rhs) * T(N);
+  CHECK(MaxAbs(strassen - blocked) <= tolerance * scale);
+}
+
+void TestStrassenFloatingAccuracy() {
+  std::mt19937 gen(26);
+  // Powers of two split exactly; the other sizes are padded with zeros.
+  CheckStrassenAccuracy<64, 16, double>(gen, 1e-13);
+  CheckStrassenAccuracy<100, 16, double>(gen, 1e-13);
+  CheckStrassenAccuracy<37, 8, double>(gen, 1e-13);
+  CheckStrassenAccuracy<129, 32, double>(gen, 1e-13);
+  CheckStrassenAccuracy<64, 16, float>(gen, 1e-5f);
+  CheckStrassenAccuracy<100, 12, float>(gen, 1e-5f);
+}
+
+void TestStrassenExactForIntegers() {
+  std::mt19937 gen(27);
+  auto lhs = RandomMatrix<75, 75, int64_t>(gen, -100, 100);
+  auto rhs = RandomMatrix<75, 75, int64_t>(gen, -100, 100);
+  CHECK(lhs.Multiply<StrassenMultiplication<10>>(rhs) == lhs * rhs);
+  // Below the cutoff the policy falls back to the blocked kernel.
+  auto small = RandomMatrix<20, 20, int64_t>(gen, -100, 100);
+  CHECK(small.Multiply<StrassenMultiplication<64>>(small) == small * small);
+}
+
+template <size_t N, size_t M, typename T>
+Matrix<M, N, T> NaiveTranspose(const Matrix<N, M, T>& matrix) {
+  Matrix<M, N, T> answer;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      answer(j, i) = matrix(i, j);
+    }
+  }
+  return answer;
+}
+
+template <size_t N, size_t M, size_t Z, typename T>
+Matrix<N, Z, T> NaiveProduct(const Matrix<N, M, T>& lhs,
+                             const Matrix<M, Z, T>& rhs) {
+  Matrix<N, Z, T> answer(T(0));
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t k = 0; k < M; ++k) {
+      for (size_t j = 0; j < Z; ++j) {
+        answer(i, j) += lhs(i, k) * rhs(k, j);
+      }
+    }
+  }
+  return answer;
+}
+
+// A view of a temporary would dangle, so only lvalues may be viewed.
+template <typename M>
+concept HasLazyTransposed =
+    requires(M&& matrix) { std::forward<M>(matrix).LazyTransposed(); };
+
+// Sizes straddle the transpose tile and the multiplication block, so the
+// ragged edges of both are covered.
+template <size_t N, size_t M>
+void CheckTransposes(std::mt19937& gen) {
+  auto matrix = RandomMatrix<N, M, int64_t>(gen, -100, 100);
+  Matrix<M, N, int64_t> expected = NaiveTranspose(matrix);
+  CHECK(matrix.Transposed() == expected);
+  CHECK(matrix.LazyTransposed().ToMatrix() == expected);
+  for (size_t i = 0; i < M; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      CHECK(matrix.LazyTransposed()(i, j) == expected(i, j));
+    }
+  }
+  auto square = RandomMatrix<N, N, int64_t>(gen, -100, 100);
+  Matrix<N, N, int64_t> transposed = square;
+  transposed.Transpose();
+  CHECK(transposed == NaiveTranspose(square));
+
+  // Products with a view read the untransposed rows.
+  auto rhs = RandomMatrix<N, 7, int64_t>(gen, -100, 100);
+  CHECK((matrix.LazyTransposed() * rhs == NaiveProduct(expected, rhs)));
+  auto lhs = RandomMatrix<5, N, int64_t>(gen, -100, 100);
+  auto other = RandomMatrix<M, N, int64_t>(gen, -100, 100);
+  CHECK((lhs * other.LazyTransposed() ==
+         NaiveProduct(lhs, NaiveTranspose(other))));
+}
+
+void TestTransposes() {
+  std::mt19937 gen(28);
+  CheckTransposes<3, 5>(gen);
+  CheckTransposes<8, 16>(gen);
+  CheckTransposes<37, 70>(gen);
+  CheckTransposes<130, 67>(gen);
+  static_assert(HasLazyTransposed<const Matrix<3, 3>&>);
+  static_assert(!HasLazyTransposed<Matrix<3, 3>>);
+}
+
+void TestBlockedProductMatchesNaive() {
+  std::mt19937 gen(30);
+  auto lhs = RandomMatrix<70, 130, int64_t>(gen, -100, 100);
+  auto rhs = RandomMatrix<130, 45, int64_t>(gen, -100, 100);
+  CHECK((lhs * rhs == NaiveProduct(lhs, rhs)));
+  CHECK((lhs.Multiply<BlockedMultiplication>(rhs) == NaiveProduct(lhs, rhs)));
+  auto small = RandomMatrix<3, 4, int64_t>(gen, -100, 100);
+  auto column = RandomMatrix<4, 1, int64_t>(gen, -100, 100);
+  CHECK((small * column == NaiveProduct(small, column)));
+}
+
+// Small matrices are stored inline, so all of this is evaluated by the
+// compiler; a constexpr regression fails the build rather than the test.
+constexpr Matrix<2, 3> kConstexprLhs({{1, 2, 3}, {4, 5, 6}});
+constexpr Matrix<3, 2> kConstexprRhs({{7, 8}, {9, 10}, {11, 12}});
+
+constexpr Matrix<3, 3, double> Rotation90() {
+  Matrix<3, 3, double> rotation(0.0);
+  rotation(0, 1) = -1.0;
+  rotation(1, 0) = 1.0;
+  rotation(2, 2) = 1.0;
+  return rotation;
+}
+
+void TestConstexprMatrix() {
+  constexpr Matrix<2, 2> product = kConstexprLhs * kConstexprRhs;
+  static_assert(product(0, 0) == 58 && product(0, 1) == 64);
+  static_assert(product(1, 0) == 139 && product(1, 1) == 154);
+  static_assert(kConstexprLhs.Transposed() ==
+                Matrix<3, 2>({{1, 4}, {2, 5}, {3, 6}}));
+  static_assert(product.Trace() == 212);
+  static_assert(product.Determinant() == 58 * 154 - 64 * 139);
+  static_assert((kConstexprRhs * kConstexprLhs).Determinant() == 0);
+  // Zero pivots force row exchanges in the exact integer elimination.
+  static_assert(
+      Matrix<4, 4>({{2, 0, 0, 1}, {0, 3, 0, 0}, {0, 0, 0, 5}, {1, 0, 4, 0}})
+          .Determinant() == -120);
+  static_assert(Rotation90().Determinant() == 1.0);
+  static_assert((Rotation90() * Rotation90()).Trace() == -1.0);
+  // The constexpr path agrees with LU at run time for floating point.
+  Matrix<4, 4, double> matrix({{0, 2, 1, 3}, {1, 1, 1, 2}, {2, 1, 0, 7},
+                               {5, 1, 2, 1}});
+  CHECK(std::abs(matrix.Determinant() -
+                 LuDecomposition<4, double>(matrix).Determinant()) < 1e-12);
+
+  static_assert(sizeof(Matrix<4, 4, double>) == 16 * sizeof(double));
+  static_assert(sizeof(Matrix<1, 16, int64_t>) == 16 * sizeof(int64_t));
+  static_assert(sizeof(Matrix<5, 5, double>) == sizeof(std::vector<double>));
+  static_assert(sizeof(Matrix<1, 17, int64_t>) ==
+                sizeof(std::vector<int64_t>));
+}
+
+void TestModularFibonacci() {
+  using Mod = Modular<998244353>;
+  Matrix<2, 2, Mod> step(Mod(0));
+  step(0, 0) = step(0, 1) = step(1, 0) = Mod(1);
+  uint64_t previous = 0;
+  uint64_t current = 1;
+  for (uint64_t n = 1; n < 1000; ++n) {
+    CHECK(step.Pow(n)(0, 1).Value() == current);
+    uint64_t next = (previous + current) % 998244353;
+    previous = current;
+    current = next;
+  }
+}
+
+template <size_t N>
+Matrix<N, N, double> Hilbert() {
+  Matrix<N, N, double> matrix;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < N; ++j) {
+      matrix(i, j) = 1.0 / static_cast<double>(i + j + 1);
+    }
+  }
+  return matrix;
+}
+
+template <size_t N>
+Matrix<N, N, double> Identity() {
+  Matrix<N, N, double> matrix(0.0);
+  for (size_t i = 0; i < N; ++i) {
+    matrix(i, i) = 1.0;
+  }
+  return matrix;
+}
+
+// Backward stability: the residual of a pivoted LU solve stays within a small
+// multiple of N * eps * |A| * |x|, however badly conditioned A is.
+template <size_t N, size_t K>
+void CheckResidual(const Matrix<N, N, double>& matrix,
+                   const Matrix<N, K, double>& rhs) {
+  Matrix<N, K, double> solution = Solve(matrix, rhs);
+  double residual = MaxAbs(matrix * solution - rhs);
+  double scale = MaxAbs(matrix) * MaxAbs(solution) * static_cast<double>(N);
+  CHECK(residual <= 100 * N * 1e-16 * scale);
+}
+
+void TestLuOnHilbertMatrices() {
+  // det(H4) = 1 / 6048000.
+  CHECK(std::abs(Hilbert<4>().Determinant() * 6048000.0 - 1.0) < 1e-9);
+  // cond(H8) is about 1.5e10, so x loses about ten digits but the residual
+  // stays at rounding level.
+  Matrix<8, 1, double> ones(1.0);
+  Matrix<8, 1, double> rhs = Hilbert<8>() * ones;
+  CheckResidual(Hilbert<8>(), rhs);
+  CHECK(MaxAbs(Solve(Hilbert<8>(), rhs) - ones) < 1e-4);
+  CheckResidual(Hilbert<12>(), Matrix<12, 3, double>(1.0));
+}
+
+void TestLuPivotsAroundZeroLeadingEntry() {
+  Matrix<3, 3, double> matrix({{0, 2, 1}, {1, 1, 1}, {2, 1, 0}});
+  LuDecomposition<3, double> lu(matrix);
+  CHECK(!lu.IsSingular());
+  CHECK(std::abs(lu.Determinant() - 3.0) < 1e-12);
+  Matrix<3, 1, double> rhs({{3}, {3}, {3}});
+  Matrix<3, 1, double> solution = lu.Solve(rhs);
+  CHECK(MaxAbs(solution - Matrix<3, 1, double>(1.0)) < 1e-12);
+  // A tiny pivot is as bad as a zero one without row exchanges.
+  Matrix<2, 2, double> tiny({{1e-20, 1}, {1, 1}});
+  Matrix<2, 1, double> tiny_solution =
+      Solve(tiny, Matrix<2, 1, double>({{1}, {2}}));
+  CHECK(std::abs(tiny_solution(0, 0) - 1.0) < 1e-12);
+  CHECK(std::abs(tiny_solution(1, 0) - 1.0) < 1e-12);
+}
+
+// Sizes above the LU block size go through the blocked trailing update.
+template <size_t N>
+void CheckInverseAndSolve(std::mt19937& gen) {
+  auto matrix = RandomMatrix<N, N, double>(gen, -1.0, 1.0);
+  Matrix<N, N, double> inverse = matrix.Inverse();
+  CHECK(MaxAbs(inverse * matrix - Identity<N>()) < 1e-9);
+  CheckResidual(matrix, RandomMatrix<N, 2, double>(gen, -1.0, 1.0));
+}
+
+void TestLuInverseAndSolve() {
+  std::mt19937 gen(29);
+  CheckInverseAndSolve<5>(gen);
+  CheckInverseAndSolve<64>(gen);
+  CheckInverseAndSolve<100>(gen);
+  CheckInverseAndSolve<150>(gen);
+}
+
+void TestLuSingularMatrix() {
+  Matrix<3, 3, double> matrix({{1, 2, 3}, {2, 4, 6}, {1, 0, 1}});
+  LuDecomposition<3, double> lu(matrix);
+  CHECK(lu.IsSingular());
+  CHECK(matrix.Determinant() == 0.0);
+  bool thrown = false;
+  try {
+    Solve(matrix, Matrix<3, 1, double>(1.0));
+  } catch (const std::domain_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  thrown = false;
+  try {
+    matrix.Inverse();
+  } catch (const std::domain_error&) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+// Roughly density of the entries are non-zero; row 1 and column 2 are left
+// empty so the CSR and CSC offsets have empty runs.
+template <size_t N, size_t M>
+Matrix<N, M, int64_t> SparseRandomMatrix(std::mt19937& gen, double density) {
+  Matrix<N, M, int64_t> matrix(0);
+  std::bernoulli_distribution present(density);
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      if (i != 1 && j != 2 && present(gen)) {
+        matrix(i, j) = std::uniform_int_distribution<int64_t>(-9, 9)(gen);
+      }
+    }
+  }
+  return matrix;
+}
+
+template <size_t N, size_t M>
+size_t CountNonZeros(const Matrix<N, M, int64_t>& matrix) {
+  size_t count = 0;
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      count += matrix(i, j) != 0 ? 1 : 0;
+    }
+  }
+  return count;
+}
+
+template <size_t N, size_t M, typename Sparse>
+void CheckSameEntries(const Sparse& sparse,
+                      const Matrix<N, M, int64_t>& dense) {
+  CHECK(sparse.ToDense() == dense);
+  CHECK(sparse.NonZeros() == CountNonZeros(dense));
+  for (size_t i = 0; i < N; ++i) {
+    for (size_t j = 0; j < M; ++j) {
+      CHECK(sparse(i, j) == dense(i, j));
+    }
+  }
+}
+
+void TestSparseRoundTrips() {
+  std::mt19937 gen(27);
+  auto dense = SparseRandomMatrix<13, 17>(gen, 0.2);
+  CsrMatrix<13, 17> csr(dense);
+  CscMatrix<13, 17> csc(dense);
+  CheckSameEntries(csr, dense);
+  CheckSameEntries(csc, dense);
+  CHECK((CsrMatrix<13, 17>(csc) == csr));
+  CHECK((CscMatrix<13, 17>(csr) == csc));
+  CheckSameEntries(csr.Transposed(), dense.Transposed());
+  CheckSameEntries(csc.Transposed(), dense.Transposed());
+
+  Matrix<13, 17, int64_t> zero(0);
+  CheckSameEntries(CsrMatrix<13, 17>(zero), zero);
+  CheckSameEntries(CscMatrix<13, 17>(zero), zero);
+  CHECK((CsrMatrix<13, 17>(zero) == CsrMatrix<13, 17>()));
+}
+
+void TestSparseProductsMatchDense() {
+  std::mt19937 gen(28);
+  auto lhs = SparseRandomMatrix<13, 17>(gen, 0.2);
+  auto rhs = SparseRandomMatrix<17, 11>(gen, 0.3);
+  auto other = SparseRandomMatrix<13, 17>(gen, 0.2);
+  auto vector = RandomMatrix<17, 1, int64_t>(gen, -9, 9);
+  auto block = RandomMatrix<17, 5, int64_t>(gen, -9, 9);
+  CsrMatrix<13, 17> csr(lhs);
+  CscMatrix<13, 17> csc(lhs);
+
+  CHECK(csr * vector == lhs * vector);
+  CHECK(csc * vector == lhs * vector);
+  CHECK(csr * block == lhs * block);
+  CHECK(csc * block == lhs * block);
+  CHECK(((csr * CsrMatrix<17, 11>(rhs)).ToDense() == lhs * rhs));
+  CHECK(((csc * CscMatrix<17, 11>(rhs)).ToDense() == lhs * rhs));
+  CheckSameEntries(csr + CsrMatrix<13, 17>(other), lhs + other);
+  CheckSameEntries(csc + CscMatrix<13, 17>(other), lhs + other);
+  // Entries that cancel drop out of the sum.
+  CheckSameEntries(csr + CsrMatrix<13, 17>(lhs * int64_t(-1)),
+                   Matrix<13, 17, int64_t>(0));
+
+  // An empty row of lhs and an empty column of rhs give empty output lines.
+  auto product = (csr * CsrMatrix<17, 11>(rhs)).ToDense();
+  for (size_t j = 0; j < 11; ++j) {
+    CHECK(product(1, j) == 0);
+  }
+  for (size_t i = 0; i < 13; ++i) {
+    CHECK(product(i, 2) == 0);
+  }
+}
+
+// Runs func and checks that it throws Exception whose message contains text.
+template <typename Exception, typename Func>
+void CheckThrows(Func func, const std::string& text = "") {
+  bool thrown = false;
+  try {
+    func();
+  } catch (const Exception& error) {
+    thrown = std::string(error.what()).find(text) != std::string::npos;
+  }
+  CHECK(thrown);
+}
+
+template <size_t N, size_t M, typename T>
+MatrixBatch<N, M, T> RandomBatch(std::mt19937& gen, size_t count, T low,
+                                 T high) {
+  MatrixBatch<N, M, T> batch(count);
+  for (size_t index = 0; index < count; ++index) {
+    batch.Set(index, RandomMatrix<N, M, T>(gen, low, high));
+  }
+  return batch;
+}
+
+// 600 matrices span two full 256-lane chunks and a partial one.
+void TestMatrixBatchMatchesPerMatrixLoop() {
+  std::mt19937 gen(33);
+  const size_t kCount = 600;
+  auto lhs = RandomBatch<3, 4, int64_t>(gen, kCount, -100, 100);
+  auto other = RandomBatch<3, 4, int64_t>(gen, kCount, -100, 100);
+  auto rhs = RandomBatch<4, 2, int64_t>(gen, kCount, -100, 100);
+  MatrixBatch<3, 2, int64_t> product = lhs * rhs;
+  MatrixBatch<3, 4, int64_t> sum = lhs + other;
+  MatrixBatch<3, 4, int64_t> difference = lhs - other;
+  MatrixBatch<4, 3, int64_t> transposed = lhs.Transposed();
+  CHECK(product.Size() == kCount && transposed.Size() == kCount);
+  for (size_t index = 0; index < kCount; ++index) {
+    Matrix<3, 4, int64_t> matrix = lhs.Get(index);
+    CHECK(product.Get(index) == matrix * rhs.Get(index));
+    CHECK(sum.Get(index) == matrix + other.Get(index));
+    CHECK(difference.Get(index) == matrix - other.Get(index));
+    CHECK(transposed.Get(index) == matrix.Transposed());
+    CHECK(lhs(index, 2, 3) == matrix(2, 3));
+  }
+  sum -= other;
+  for (size_t index = 0; index < kCount; ++index) {
+    CHECK(sum.Get(index) == lhs.Get(index));
+  }
+
+  auto left = RandomBatch<4, 4, double>(gen, 300, -1.0, 1.0);
+  auto right = RandomBatch<4, 4, double>(gen, 300, -1.0, 1.0);
+  MatrixBatch<4, 4, double> squares = left * right;
+  for (size_t index = 0; index < 300; ++index) {
+    CHECK(MaxAbs(squares.Get(index) - left.Get(index) * right.Get(index)) <
+          1e-12);
+  }
+
+  MatrixBatch<3, 4, int64_t> shorter(kCount - 1);
+  CheckThrows<std::invalid_argument>([&] { lhs += shorter; });
+}
+
+void TestMatrixFileRoundTrip() {
+  std::mt19937 gen(32);
+  std::filesystem::path path = std::filesystem::temp_directory_path() /
+                               ("matrix_test_" + std::to_string(::getpid()));
+  std::string file = path.string();
+
+  auto matrix = RandomMatrix<70, 45, double>(gen, -1.0, 1.0);
+  SaveBinary(matrix, file);
+  {
+    MappedMatrix<70, 45, double> mapped(file);
+    CHECK(mapped.ToMatrix() == matrix);
+    CHECK(mapped(69, 44) == matrix(69, 44));
+    CHECK(reinterpret_cast<uintptr_t>(mapped.Data()) % 64 == 0);
+    auto rhs = RandomMatrix<45, 3, double>(gen, -1.0, 1.0);
+    CHECK(mapped * rhs == matrix * rhs);
+    MappedMatrix<70, 45, double> moved(std::move(mapped));
+    CHECK(moved(3, 4) == matrix(3, 4));
+  }
+  CHECK((LoadBinary<70, 45, double>(file) == matrix));
+
+  // A header that disagrees with the requested shape or element type.
+  CheckThrows<std::runtime_error>(
+      [&] { MappedMatrix<45, 70, double> wrong(file); }, "does not match");
+  CheckThrows<std::runtime_error>(
+      [&] { MappedMatrix<70, 45, int64_t> wrong(file); }, "does not match");
+  CheckThrows<std::runtime_error>(
+      [&] { MappedMatrix<70, 45, float> wrong(file); }, "does not match");
+  CheckThrows<std::runtime_error>(
+      [&] { MappedMatrix<71, 45, double> wrong(file); }, "truncated");
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  CheckThrows<std::runtime_error>(
+      [&] { MappedMatrix<70, 45, double> truncated(file); }, "truncated");
+  std::filesystem::remove(path);
+  CheckThrows<std::runtime_error>(
+      [&] { MappedMatrix<70, 45, double> missing(file); }, "cannot open");
+
+  // Streaming rows one at a time.
+  {
+    MatrixWriter<2, 3, int32_t> writer(file);
+    writer.WriteRow(std::vector<int32_t>{1, 2, 3});
+    CheckThrows<std::invalid_argument>(
+        [&] { writer.WriteRow(std::vector<int32_t>{1, 2}); });
+    CheckThrows<std::runtime_error>([&] { writer.Close(); }, "incomplete");
+    writer.WriteRow(std::vector<int32_t>{4, 5, 6});
+    CheckThrows<std::out_of_range>(
+        [&] { writer.WriteRow(std::vector<int32_t>{7, 8, 9}); });
+    writer.Close();
+  }
+  CHECK((LoadBinary<2, 3, int32_t>(file) ==
+         Matrix<2, 3, int32_t>({{1, 2, 3}, {4, 5, 6}})));
+  std::filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+  TestStrassenFloatingAccuracy();
+  TestStrassenExactForIntegers();
+  TestConstexprMatrix();
+  TestModularFibonacci();
+  TestLuOnHilbertMatrices();
+  TestLuPivotsAroundZeroLeadingEntry();
+  TestLuInverseAndSolve();
+  TestLuSingularMatrix();
+  TestTransposes();
+  TestBlockedProductMatchesNaive();
+  TestMatrixFileRoundTrip();
+  TestMatrixBatchMatchesPerMatrixLoop();
+  TestSparseRoundTrips();
+  TestSparseProductsMatchDense();
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "smart_pointers/shared_ptr.hpp"
+#include "tests/benchmark.hpp"
+
+namespace {
+
+// Every thread copies and drops the same pointer, so all of them hammer one
+// reference count.
+template <typename Pointer, typename Weak>
+void CopyAndDestroy(const Pointer& shared, int threads, int copies) {
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&shared, copies] {
+      uint64_t sum = 0;
+      for (int i = 0; i < copies; ++i) {
+        Pointer copy = shared;
+        sum += *copy;
+      }
+      Weak weak(shared);
+      for (int i = 0; i < copies / 10; ++i) {
+        sum += *weak.lock();
+      }
+      benchmark_sink = benchmark_sink + sum;
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace
+
+int main() {
+  const int kCopies = 2'000'000;
+  auto shared = MakeShared<int>(1);
+  auto reference = std::make_shared<int>(1);
+  int cores =
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  Section("Copies and weak locks of one pointer, 2M copies per thread");
+  for (int threads = 1; threads <= std::max(4, cores); threads *= 2) {
+    std::string label = std::to_string(threads) + " threads";
+    Measure("SharedPtr, " + label, [&] {
+      CopyAndDestroy<SharedPtr<int>, WeakPtr<int>>(shared, threads, kCopies);
+    });
+    Measure("std::shared_ptr, " + label, [&] {
+      CopyAndDestroy<std::shared_ptr<int>, std::weak_ptr<int>>(
+          reference, threads, kCopies);
+    });
+  }
+}
@@ -0,0 +1,86 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "smart_pointers/shared_ptr.hpp"
+#include "tests/check.hpp"
+
+namespace {
+
+std::atomic<int> alive{0};
+
+struct Counted {
+  explicit Counted(int value) : value(value) { ++alive; }
+  ~Counted() { --alive; }
+
+  int value;
+};
+
+void TestOwnershipAndWeakLock() {
+  {
+    SharedPtr<Counted> owner(new Counted(1));
+    WeakPtr<Counted> weak(owner);
+    CHECK(!weak.expired());
+    {
+      SharedPtr<Counted> locked = weak.lock();
+      CHECK(locked.get() == owner.get());
+      CHECK(owner.use_count() == 2);
+    }
+    owner.reset();
+    CHECK(weak.expired());
+    CHECK(weak.lock().get() == nullptr);
+    CHECK(alive == 0);
+  }
+  WeakPtr<Counted> empty;
+  CHECK(empty.lock().get() == nullptr);
+  auto made = MakeShared<Counted>(2);
+  WeakPtr<Counted> weak(made);
+  WeakPtr<Counted> moved(std::move(weak));
+  CHECK(moved.lock()->value == 2);
+  made.reset();
+  CHECK(alive == 0);
+}
+
+// Copies are made and dropped on several threads while others lock weak
+// references and the original owner lets go: the object must be destroyed
+// exactly once, and a successful lock must always see a live object.
+void TestConcurrentCopiesAndLocks() {
+  for (int round = 0; round < 200; ++round) {
+    auto owner = MakeShared<Counted>(round);
+    WeakPtr<Counted> weak(owner);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+      threads.emplace_back([copy = owner]() mutable {
+        for (int i = 0; i < 200; ++i) {
+          SharedPtr<Counted> local = copy;
+          SharedPtr<Counted> other;
+          other = local;
+        }
+        copy.reset();
+      });
+    }
+    for (int t = 0; t < 2; ++t) {
+      threads.emplace_back([weak, round]() mutable {
+        for (int i = 0; i < 200; ++i) {
+          SharedPtr<Counted> locked = weak.lock();
+          if (locked.get() != nullptr) {
+            CHECK(locked->value == round);
+          }
+        }
+      });
+    }
+    owner.reset();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    CHECK(weak.expired());
+    CHECK(alive == 0);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestOwnershipAndWeakLock();
+  TestConcurrentCopiesAndLocks();
+}